@@ -0,0 +1,1107 @@
+//
+// bench.c
+//
+// Computer Science 50
+// Problem Set 6
+//
+// a load generator for server: drives it over loopback with many connections,
+// optionally kept alive and pipelined, and reports its throughput and latency
+//
+
+// feature test macro requirements
+#define _GNU_SOURCE
+
+// default number of connections, of requests in flight per connection, and of
+// seconds for which to run
+#define CONNECTIONS 64
+#define DEPTH 1
+#define SECONDS 10
+
+// maximum number of requests in flight per connection
+#define PIPELINE 64
+
+// maximum number of events to handle per call to epoll_wait, and number of
+// milliseconds to wait for them before checking whether benchmark is over
+#define EVENTS 64
+#define TICK 100
+
+// number of bytes to read from server at once, and most to buffer of a
+// response's head or chunked body
+#define BYTES 65536
+#define LIMIT (1024 * 1024)
+
+// latencies, in nanoseconds, are counted in buckets, as by HdrHistogram: the
+// first 2 * SUBBUCKETS hold one value each, and each power of two thereafter,
+// up to 2^MAGNITUDES, is split into SUBBUCKETS, so that every latency is
+// recorded to within 1 part in SUBBUCKETS
+#define SUBBUCKETS 128
+#define MAGNITUDES 40
+#define BUCKETS ((MAGNITUDES - 6) * SUBBUCKETS)
+
+// header files
+#include <arpa/inet.h>
+#include <errno.h>
+#include <limits.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+// a request, rendered once, to be sent as many times as benchmark needs
+typedef struct target
+{
+    char* request;
+    size_t length;
+}
+target;
+
+// what a worker measured
+typedef struct stats
+{
+    // number of responses received, by class of status code (0 for
+    // malformed), and of requests that failed
+    size_t completed;
+    size_t classes[6];
+    size_t errors;
+
+    // number of connections opened, and of bytes received
+    size_t connects;
+    size_t bytes;
+
+    // responses' latencies: their counts, by bucket, and their sum, minimum, and maximum
+    uint64_t histogram[BUCKETS];
+    uint64_t sum;
+    uint64_t min;
+    uint64_t max;
+
+    // time at which worker finished
+    uint64_t finished;
+}
+stats;
+
+// a connection to server
+typedef struct connection
+{
+    // socket, and whether it's connected yet
+    int fd;
+    bool connected;
+
+    // requests rendered but not yet sent
+    char* output;
+    size_t capacity;
+    size_t length;
+    size_t sent;
+
+    // times at which requests still in flight were queued, oldest first
+    uint64_t queued[PIPELINE];
+    int first;
+    int inflight;
+
+    // bytes received but not yet parsed, which start at offset
+    char* input;
+    size_t size;
+    size_t received;
+    size_t offset;
+
+    // where in a response parsing is, its status code, bytes of its body
+    // still to skip, and whether server will close connection after it
+    enum {HEAD, LENGTH, CHUNKED, UNTIL} stage;
+    int status;
+    size_t remaining;
+    bool closing;
+
+    // index of next target to request
+    int next;
+}
+connection;
+
+// a thread that drives some of the connections
+typedef struct worker
+{
+    pthread_t thread;
+    int first;
+    int n;
+    stats stats;
+}
+worker;
+
+// prototypes
+uint64_t bucket(int slot);
+long chunks(const char* s, size_t length);
+bool claim(void);
+void complete(connection* c, stats* s);
+bool dial(connection* c, stats* s);
+void disconnect(connection* c);
+void fail(connection* c, stats* s);
+bool field(const char* line, const char* name, char* value, size_t size);
+void fill(connection* c);
+void handler(int signal);
+bool load(const char* file);
+uint64_t now(void);
+bool parse(connection* c, stats* s);
+uint64_t percentile(const stats* s, double p);
+bool receive(connection* c, stats* s);
+bool render(const char* path);
+int slot(uint64_t value);
+bool transmit(connection* c);
+void* work(void* arg);
+
+// server's address, and value of requests' Host header
+struct sockaddr_in address;
+char host[INET_ADDRSTRLEN + 8];
+
+// requests to send, in order, cycling
+target* targets = NULL;
+int ntargets = 0;
+
+// number of requests each connection keeps in flight, and whether connections are kept alive
+int depth = DEPTH;
+bool keep = false;
+
+// connections, and number thereof
+connection* connections = NULL;
+int nconnections = CONNECTIONS;
+
+// number of requests to send (0 if benchmark is timed instead), and number sent so far
+size_t limit = 0;
+atomic_size_t issued = 0;
+
+// whether benchmark is over, and number of workers still running
+atomic_bool over = false;
+atomic_int running = 0;
+
+// whether control-c has been heard
+volatile sig_atomic_t signaled = false;
+
+int main(int argc, char* argv[])
+{
+    // usage
+    const char* usage = "Usage: bench [-c connections] [-d depth] [-f file] [-h] [-k] [-n requests] [-p port] [-t seconds] [-w workers] [address]";
+
+    // defaults
+    int port = 8080;
+    int seconds = SECONDS;
+    int n = 1;
+    const char* file = NULL;
+
+    // parse command-line arguments
+    int opt;
+    while ((opt = getopt(argc, argv, "c:d:f:hkn:p:t:w:")) != -1)
+    {
+        switch (opt)
+        {
+            // -c connections
+            case 'c':
+                nconnections = atoi(optarg);
+                break;
+
+            // -d depth
+            case 'd':
+                depth = atoi(optarg);
+                break;
+
+            // -f file
+            case 'f':
+                file = optarg;
+                break;
+
+            // -h
+            case 'h':
+                printf("%s\n", usage);
+                return 0;
+
+            // -k
+            case 'k':
+                keep = true;
+                break;
+
+            // -n requests
+            case 'n':
+                limit = strtoull(optarg, NULL, 10);
+                break;
+
+            // -p port
+            case 'p':
+                port = atoi(optarg);
+                break;
+
+            // -t seconds
+            case 't':
+                seconds = atoi(optarg);
+                break;
+
+            // -w workers
+            case 'w':
+                n = atoi(optarg);
+                break;
+
+            default:
+                printf("%s\n", usage);
+                return 2;
+        }
+    }
+
+    // ensure arguments are sane, and that requests are only pipelined on connections kept alive
+    if (nconnections < 1 || depth < 1 || depth > PIPELINE || port < 1 || port > USHRT_MAX || seconds < 1 || n < 1 || optind + 1 < argc)
+    {
+        printf("%s\n", usage);
+        return 2;
+    }
+    if (depth > 1 && !keep)
+    {
+        printf("Pipelining requires -k\n");
+        return 2;
+    }
+    if (n > nconnections)
+    {
+        n = nconnections;
+    }
+
+    // resolve server's address, which defaults to loopback
+    const char* ip = (optind < argc) ? argv[optind] : "127.0.0.1";
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, ip, &address.sin_addr) != 1)
+    {
+        printf("Invalid address: %s\n", ip);
+        return 2;
+    }
+    snprintf(host, sizeof(host), "%s:%i", ip, port);
+
+    // render requests for file's paths, else for server's root
+    if (file != NULL ? !load(file) : !render("/"))
+    {
+        printf("Could not load %s\n", file);
+        return 1;
+    }
+    if (ntargets == 0)
+    {
+        printf("No paths in %s\n", file);
+        return 1;
+    }
+
+    // listen for SIGINT (aka control-c), so that benchmark can end early but still report
+    struct sigaction act;
+    act.sa_handler = handler;
+    act.sa_flags = 0;
+    sigemptyset(&act.sa_mask);
+    sigaction(SIGINT, &act, NULL);
+
+    // ignore SIGPIPE, so that sending to a server that's closed connection fails with EPIPE instead
+    act.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &act, NULL);
+
+    // share connections evenly among workers
+    connections = calloc(nconnections, sizeof(connection));
+    worker* workers = calloc(n, sizeof(worker));
+    if (connections == NULL || workers == NULL)
+    {
+        printf("Out of memory\n");
+        return 1;
+    }
+    if (limit > 0)
+    {
+        printf("Sending %zu requests over %i connections with %i workers\n", limit, nconnections, n);
+    }
+    else
+    {
+        printf("Sending requests for %i seconds over %i connections with %i workers\n", seconds, nconnections, n);
+    }
+    uint64_t start = now();
+    atomic_store(&running, n);
+    for (int i = 0, first = 0; i < n; i++)
+    {
+        workers[i].first = first;
+        workers[i].n = nconnections / n + (i < nconnections % n);
+        first += workers[i].n;
+        workers[i].stats.min = UINT64_MAX;
+        errno = pthread_create(&workers[i].thread, NULL, work, &workers[i]);
+        if (errno != 0)
+        {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    // wait until time's up, control-c is heard, or workers have sent every request
+    uint64_t end = start + (uint64_t) seconds * 1000000000;
+    while (atomic_load(&running) > 0)
+    {
+        if (signaled || (limit == 0 && now() >= end))
+        {
+            end = now();
+            atomic_store(&over, true);
+            break;
+        }
+        struct timespec pause = {0, 10 * 1000 * 1000};
+        nanosleep(&pause, NULL);
+    }
+    for (int i = 0; i < n; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    // merge workers' measurements
+    stats total;
+    memset(&total, 0, sizeof(total));
+    total.min = UINT64_MAX;
+    for (int i = 0; i < n; i++)
+    {
+        stats* s = &workers[i].stats;
+        total.completed += s->completed;
+        for (int j = 0; j < 6; j++)
+        {
+            total.classes[j] += s->classes[j];
+        }
+        total.errors += s->errors;
+        total.connects += s->connects;
+        total.bytes += s->bytes;
+        for (int j = 0; j < BUCKETS; j++)
+        {
+            total.histogram[j] += s->histogram[j];
+        }
+        total.sum += s->sum;
+        total.min = (s->min < total.min) ? s->min : total.min;
+        total.max = (s->max > total.max) ? s->max : total.max;
+        if (!atomic_load(&over) && s->finished > total.finished)
+        {
+            total.finished = s->finished;
+        }
+    }
+
+    // if workers sent every request, benchmark ended when last of them finished
+    if (!atomic_load(&over))
+    {
+        end = total.finished;
+    }
+    double elapsed = (end - start) / 1e9;
+
+    // report
+    printf("%zu responses in %.2f s, %zu errors, %zu connections\n", total.completed, elapsed, total.errors, total.connects);
+    printf("%.0f requests/s, %.2f MB/s\n", total.completed / elapsed, total.bytes / elapsed / (1024 * 1024));
+    printf("1xx %zu, 2xx %zu, 3xx %zu, 4xx %zu, 5xx %zu, malformed %zu\n",
+        total.classes[1], total.classes[2], total.classes[3], total.classes[4], total.classes[5], total.classes[0]);
+    if (total.completed > 0)
+    {
+        printf("latency (us): min %.1f, mean %.1f, p50 %.1f, p90 %.1f, p99 %.1f, p99.9 %.1f, max %.1f\n",
+            total.min / 1e3, (double) total.sum / total.completed / 1e3,
+            percentile(&total, 50.0) / 1e3, percentile(&total, 90.0) / 1e3, percentile(&total, 99.0) / 1e3,
+            percentile(&total, 99.9) / 1e3, total.max / 1e3);
+    }
+
+    // free requests
+    for (int i = 0; i < ntargets; i++)
+    {
+        free(targets[i].request);
+    }
+    free(targets);
+    free(connections);
+    free(workers);
+    return (total.completed > 0) ? 0 : 1;
+}
+
+/**
+ * Returns highest latency that bucket at slot counts.
+ */
+uint64_t bucket(int slot)
+{
+    if (slot < 2 * SUBBUCKETS)
+    {
+        return slot;
+    }
+    int magnitude = (slot - 2 * SUBBUCKETS) / SUBBUCKETS + 1;
+    uint64_t sub = (slot - 2 * SUBBUCKETS) % SUBBUCKETS + SUBBUCKETS;
+    return ((sub + 1) << magnitude) - 1;
+}
+
+/**
+ * Measures chunked body at s. Returns its length (through its last chunk
+ * and trailer), 0 if it's incomplete, or -1 if it's malformed.
+ */
+long chunks(const char* s, size_t length)
+{
+    size_t i = 0;
+    while (true)
+    {
+        // read chunk's size, ignoring any extensions
+        const char* crlf = memmem(s + i, length - i, "\r\n", 2);
+        if (crlf == NULL)
+        {
+            return 0;
+        }
+        char* end;
+        unsigned long size = strtoul(s + i, &end, 16);
+        if (end == s + i)
+        {
+            return -1;
+        }
+        i = crlf - s + 2;
+
+        // skip trailer after last chunk
+        if (size == 0)
+        {
+            while (true)
+            {
+                crlf = memmem(s + i, length - i, "\r\n", 2);
+                if (crlf == NULL)
+                {
+                    return 0;
+                }
+                if (crlf == s + i)
+                {
+                    return i + 2;
+                }
+                i = crlf - s + 2;
+            }
+        }
+
+        // skip chunk's data and its CRLF
+        if (length - i < size + 2)
+        {
+            return 0;
+        }
+        i += size + 2;
+    }
+}
+
+/**
+ * Reserves one of benchmark's requests for sending. Returns true if there
+ * was one to send, else false.
+ */
+bool claim(void)
+{
+    if (atomic_load(&over))
+    {
+        return false;
+    }
+    if (limit == 0)
+    {
+        return true;
+    }
+    if (atomic_fetch_add(&issued, 1) < limit)
+    {
+        return true;
+    }
+    atomic_fetch_sub(&issued, 1);
+    return false;
+}
+
+/**
+ * Records response to connection's oldest request in flight.
+ */
+void complete(connection* c, stats* s)
+{
+    // only count responses received before benchmark was over
+    if (!atomic_load(&over))
+    {
+        uint64_t latency = now() - c->queued[c->first];
+        s->histogram[slot(latency)]++;
+        s->sum += latency;
+        s->min = (latency < s->min) ? latency : s->min;
+        s->max = (latency > s->max) ? latency : s->max;
+        s->completed++;
+        s->classes[(c->status >= 100 && c->status < 600) ? c->status / 100 : 0]++;
+    }
+    c->first = (c->first + 1) % PIPELINE;
+    c->inflight--;
+    c->stage = HEAD;
+}
+
+/**
+ * Opens connection to server, without waiting for it to be established.
+ * Returns true on success, else false.
+ */
+bool dial(connection* c, stats* s)
+{
+    c->fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+    if (c->fd == -1)
+    {
+        return false;
+    }
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (connect(c->fd, (struct sockaddr*) &address, sizeof(address)) == -1 && errno != EINPROGRESS)
+    {
+        return false;
+    }
+    s->connects++;
+    return true;
+}
+
+/**
+ * Closes connection, forgetting anything sent or received thereon.
+ */
+void disconnect(connection* c)
+{
+    if (c->fd != -1)
+    {
+        close(c->fd);
+        c->fd = -1;
+    }
+    c->connected = false;
+    c->length = c->sent = 0;
+    c->received = c->offset = 0;
+    c->first = c->inflight = 0;
+    c->stage = HEAD;
+    c->closing = false;
+}
+
+/**
+ * Handles connection's failure, counting its requests in flight as failed.
+ */
+void fail(connection* c, stats* s)
+{
+    s->errors += (c->inflight > 0) ? c->inflight : 1;
+    disconnect(c);
+}
+
+/**
+ * Copies into value, of size bytes, the string that's the value of member
+ * name in line, a JSON object. Returns true if found, else false.
+ */
+bool field(const char* line, const char* name, char* value, size_t size)
+{
+    // find member's name
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\"", name);
+    const char* p = strstr(line, key);
+    if (p == NULL)
+    {
+        return false;
+    }
+    p += strlen(key);
+    while (*p == ' ' || *p == '\t')
+    {
+        p++;
+    }
+    if (*p++ != ':')
+    {
+        return false;
+    }
+    while (*p == ' ' || *p == '\t')
+    {
+        p++;
+    }
+    if (*p++ != '"')
+    {
+        return false;
+    }
+
+    // copy its value, unescaping as needed
+    size_t n = 0;
+    for (; *p != '"'; p++)
+    {
+        if (*p == '\0' || n + 1 >= size)
+        {
+            return false;
+        }
+        if (*p == '\\')
+        {
+            p++;
+            if (*p != '"' && *p != '\\' && *p != '/')
+            {
+                return false;
+            }
+        }
+        value[n++] = *p;
+    }
+    value[n] = '\0';
+    return true;
+}
+
+/**
+ * Queues requests on connection until depth of them are in flight.
+ */
+void fill(connection* c)
+{
+    while (c->inflight < depth && !c->closing)
+    {
+        // grow output as needed
+        target* t = &targets[c->next];
+        if (c->length + t->length > c->capacity)
+        {
+            size_t capacity = (c->length + t->length) * 2;
+            char* output = realloc(c->output, capacity);
+            if (output == NULL)
+            {
+                return;
+            }
+            c->output = output;
+            c->capacity = capacity;
+        }
+        if (!claim())
+        {
+            return;
+        }
+        c->next = (c->next + 1) % ntargets;
+        memcpy(c->output + c->length, t->request, t->length);
+        c->length += t->length;
+        c->queued[(c->first + c->inflight) % PIPELINE] = now();
+        c->inflight++;
+
+        // without keep-alive, server closes connection after one response
+        if (!keep)
+        {
+            c->closing = true;
+        }
+    }
+}
+
+/**
+ * Handles signals.
+ */
+void handler(int signal)
+{
+    if (signal == SIGINT)
+    {
+        signaled = true;
+    }
+}
+
+/**
+ * Renders a request for each path in file, one per line, whether bare (as
+ * in a log) or the "path" member of a JSON object (as in a .jsonl file).
+ * Lines that are blank or start with # are skipped. Returns true if file
+ * could be read, else false.
+ */
+bool load(const char* file)
+{
+    FILE* f = fopen(file, "r");
+    if (f == NULL)
+    {
+        return false;
+    }
+    char* line = NULL;
+    size_t size = 0;
+    ssize_t n;
+    bool ok = true;
+    while (ok && (n = getline(&line, &size, f)) != -1)
+    {
+        // trim line
+        while (n > 0 && (line[n - 1] == '\n' || line[n - 1] == '\r' || line[n - 1] == ' '))
+        {
+            line[--n] = '\0';
+        }
+        if (n == 0 || line[0] == '#')
+        {
+            continue;
+        }
+
+        // find line's path
+        char path[8192];
+        if (line[0] == '{')
+        {
+            if (!field(line, "path", path, sizeof(path)) && !field(line, "url", path, sizeof(path)))
+            {
+                continue;
+            }
+        }
+        else if ((size_t) n < sizeof(path))
+        {
+            strcpy(path, line);
+        }
+        else
+        {
+            continue;
+        }
+        if (path[0] != '/' || strpbrk(path, " \r\n") != NULL)
+        {
+            continue;
+        }
+        ok = render(path);
+    }
+    free(line);
+    fclose(f);
+    return ok;
+}
+
+/**
+ * Returns current time, in nanoseconds, on a monotonic clock.
+ */
+uint64_t now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * Parses as many responses as connection has received. Returns false if
+ * one was malformed, else true.
+ */
+bool parse(connection* c, stats* s)
+{
+    while (c->offset < c->received)
+    {
+        char* p = c->input + c->offset;
+        size_t length = c->received - c->offset;
+
+        // response's head
+        if (c->stage == HEAD)
+        {
+            char* crlf = memmem(p, length, "\r\n\r\n", 4);
+            if (crlf == NULL)
+            {
+                return length < LIMIT;
+            }
+            if (c->inflight == 0 || length < 12 || strncmp(p, "HTTP/1.", 7) != 0)
+            {
+                return false;
+            }
+            *crlf = '\0';
+            c->status = atoi(p + 9);
+            c->offset += crlf - p + 4;
+
+            // determine how body's length is delimited
+            long n = -1;
+            bool chunked = false;
+            c->closing = !keep || strncmp(p, "HTTP/1.0", 8) == 0;
+            for (char* line = strstr(p, "\r\n"); line != NULL; line = strstr(line, "\r\n"))
+            {
+                line += 2;
+                if (strncasecmp(line, "Content-Length:", 15) == 0)
+                {
+                    n = atol(line + 15);
+                }
+                else if (strncasecmp(line, "Transfer-Encoding:", 18) == 0)
+                {
+                    chunked = strcasestr(line, "chunked") != NULL;
+                }
+                else if (strncasecmp(line, "Connection:", 11) == 0)
+                {
+                    c->closing = c->closing || strcasestr(line, "close") != NULL;
+                }
+            }
+            if (c->status >= 100 && c->status < 200)
+            {
+                continue;
+            }
+            else if (c->status == 204 || c->status == 304 || n == 0)
+            {
+                complete(c, s);
+            }
+            else if (chunked)
+            {
+                c->stage = CHUNKED;
+            }
+            else if (n > 0)
+            {
+                c->stage = LENGTH;
+                c->remaining = n;
+            }
+            else
+            {
+                c->stage = UNTIL;
+            }
+        }
+
+        // body whose length is known
+        else if (c->stage == LENGTH)
+        {
+            size_t n = (length < c->remaining) ? length : c->remaining;
+            c->offset += n;
+            c->remaining -= n;
+            if (c->remaining == 0)
+            {
+                complete(c, s);
+            }
+        }
+
+        // chunked body, which is buffered until complete
+        else if (c->stage == CHUNKED)
+        {
+            long n = chunks(p, length);
+            if (n == -1)
+            {
+                return false;
+            }
+            if (n == 0)
+            {
+                return length < LIMIT;
+            }
+            c->offset += n;
+            complete(c, s);
+        }
+
+        // body that ends when server closes connection
+        else
+        {
+            c->offset = c->received;
+        }
+    }
+    return true;
+}
+
+/**
+ * Returns latency below which p percent of responses were received.
+ */
+uint64_t percentile(const stats* s, double p)
+{
+    uint64_t target = (uint64_t) (p / 100.0 * s->completed + 0.5);
+    if (target == 0)
+    {
+        target = 1;
+    }
+    uint64_t count = 0;
+    for (int i = 0; i < BUCKETS; i++)
+    {
+        count += s->histogram[i];
+        if (count >= target)
+        {
+            uint64_t value = bucket(i);
+            return (value < s->max) ? value : s->max;
+        }
+    }
+    return s->max;
+}
+
+/**
+ * Reads from connection until it would block, parsing responses as they
+ * arrive. Returns false if connection failed or was closed, else true.
+ */
+bool receive(connection* c, stats* s)
+{
+    while (true)
+    {
+        // make room for more input, discarding what's been parsed
+        if (c->offset > 0)
+        {
+            memmove(c->input, c->input + c->offset, c->received - c->offset);
+            c->received -= c->offset;
+            c->offset = 0;
+        }
+        if (c->size - c->received < BYTES)
+        {
+            char* input = realloc(c->input, c->size + BYTES);
+            if (input == NULL)
+            {
+                fail(c, s);
+                return false;
+            }
+            c->input = input;
+            c->size += BYTES;
+        }
+
+        ssize_t n = recv(c->fd, c->input + c->received, c->size - c->received, 0);
+        if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return true;
+        }
+        if (n == -1)
+        {
+            fail(c, s);
+            return false;
+        }
+
+        // server closed connection, which ends a body without a length
+        if (n == 0)
+        {
+            if (c->stage == UNTIL)
+            {
+                complete(c, s);
+            }
+            if (c->inflight > 0)
+            {
+                fail(c, s);
+            }
+            else
+            {
+                disconnect(c);
+            }
+            return false;
+        }
+        c->received += n;
+        s->bytes += n;
+        if (!parse(c, s))
+        {
+            fail(c, s);
+            return false;
+        }
+
+        // once server's sent its last response, close connection
+        if (c->closing && c->inflight == 0)
+        {
+            disconnect(c);
+            return false;
+        }
+    }
+}
+
+/**
+ * Renders a request for path. Returns true on success, else false.
+ */
+bool render(const char* path)
+{
+    target* t = realloc(targets, (ntargets + 1) * sizeof(target));
+    if (t == NULL)
+    {
+        return false;
+    }
+    targets = t;
+    int n = asprintf(&targets[ntargets].request, "GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n",
+        path, host, keep ? "" : "Connection: close\r\n");
+    if (n == -1)
+    {
+        return false;
+    }
+    targets[ntargets].length = n;
+    ntargets++;
+    return true;
+}
+
+/**
+ * Returns slot of bucket that counts latency of value nanoseconds.
+ */
+int slot(uint64_t value)
+{
+    if (value >= (1ULL << MAGNITUDES))
+    {
+        value = (1ULL << MAGNITUDES) - 1;
+    }
+    if (value < 2 * SUBBUCKETS)
+    {
+        return value;
+    }
+    int magnitude = 63 - __builtin_clzll(value) - 7;
+    return 2 * SUBBUCKETS + (magnitude - 1) * SUBBUCKETS + (int) ((value >> magnitude) - SUBBUCKETS);
+}
+
+/**
+ * Sends as much of connection's output as it can without blocking.
+ * Returns false if connection failed, else true.
+ */
+bool transmit(connection* c)
+{
+    while (c->sent < c->length)
+    {
+        ssize_t n = send(c->fd, c->output + c->sent, c->length - c->sent, MSG_NOSIGNAL);
+        if (n == -1)
+        {
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->sent += n;
+    }
+    c->length = c->sent = 0;
+    return true;
+}
+
+/**
+ * Drives a worker's connections until benchmark is over.
+ */
+void* work(void* arg)
+{
+    worker* w = arg;
+    stats* s = &w->stats;
+
+    int epfd = epoll_create1(0);
+    if (epfd == -1)
+    {
+        perror("epoll_create1");
+        atomic_fetch_sub(&running, 1);
+        return NULL;
+    }
+
+    // open worker's connections, each starting at a different target so that URLs are mixed
+    for (int i = w->first; i < w->first + w->n; i++)
+    {
+        connection* c = &connections[i];
+        c->fd = -1;
+        c->next = i % ntargets;
+    }
+    struct epoll_event events[EVENTS];
+    while (!atomic_load(&over))
+    {
+        // (re)open closed connections as long as there are requests to send,
+        // and close those that have none in flight once there aren't
+        int active = 0;
+        for (int i = w->first; i < w->first + w->n; i++)
+        {
+            connection* c = &connections[i];
+            fill(c);
+            if (c->inflight == 0)
+            {
+                disconnect(c);
+                continue;
+            }
+            if (c->fd == -1)
+            {
+                if (!dial(c, s))
+                {
+                    fail(c, s);
+                    continue;
+                }
+                struct epoll_event event = {.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data.ptr = c};
+                epoll_ctl(epfd, EPOLL_CTL_ADD, c->fd, &event);
+            }
+            else if (c->connected && !transmit(c))
+            {
+                fail(c, s);
+                continue;
+            }
+            active++;
+        }
+        if (active == 0)
+        {
+            break;
+        }
+
+        int n = epoll_wait(epfd, events, EVENTS, TICK);
+        for (int i = 0; i < n; i++)
+        {
+            connection* c = events[i].data.ptr;
+            if (c->fd == -1)
+            {
+                continue;
+            }
+
+            // learn whether connection was established
+            if (!c->connected)
+            {
+                int error = 0;
+                socklen_t length = sizeof(error);
+                if (getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &error, &length) == -1 || error != 0)
+                {
+                    fail(c, s);
+                    continue;
+                }
+                c->connected = true;
+            }
+
+            // read responses, then queue and send more requests
+            if ((events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !receive(c, s))
+            {
+                continue;
+            }
+            fill(c);
+            if (!transmit(c))
+            {
+                fail(c, s);
+            }
+        }
+    }
+
+    // close worker's connections
+    for (int i = w->first; i < w->first + w->n; i++)
+    {
+        connection* c = &connections[i];
+        disconnect(c);
+        free(c->output);
+        free(c->input);
+    }
+    close(epfd);
+    s->finished = now();
+    atomic_fetch_sub(&running, 1);
+    return NULL;
+}
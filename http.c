@@ -0,0 +1,694 @@
+//
+// http.c
+//
+// Computer Science 50
+// Problem Set 6
+//
+
+// feature test macro requirements
+#define _GNU_SOURCE
+
+// header files
+#include <ctype.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "http.h"
+
+// SIMD intrinsics, for scanning requests
+#if defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+// an extension and its MIME type
+typedef struct mime
+{
+    const char* extension;
+    const char* type;
+}
+mime;
+
+// MIME types, builtin and loaded from a mime.types file, in a perfect hash
+// table (with displacements for each of its buckets) built by mimetypes
+mime* types = NULL;
+size_t ntypes = 0;
+unsigned int* displacements = NULL;
+size_t ndisplacements = 0;
+
+// entity for each character that HTML requires be escaped, and number of
+// bytes by which it's longer than character itself (0 for all others)
+const char* entities[256] = {['"'] = "&quot;", ['&'] = "&amp;", ['\''] = "&#039;", ['<'] = "&lt;", ['>'] = "&gt;"};
+const unsigned char growth[256] = {['"'] = 5, ['&'] = 4, ['\''] = 5, ['<'] = 3, ['>'] = 3};
+
+// value of each hexadecimal digit, with 0x10 set for (only) hexadecimal digits
+const unsigned char hexits[256] =
+{
+    ['0'] = 0x10, ['1'] = 0x11, ['2'] = 0x12, ['3'] = 0x13, ['4'] = 0x14, ['5'] = 0x15, ['6'] = 0x16, ['7'] = 0x17,
+    ['8'] = 0x18, ['9'] = 0x19, ['A'] = 0x1A, ['B'] = 0x1B, ['C'] = 0x1C, ['D'] = 0x1D, ['E'] = 0x1E, ['F'] = 0x1F,
+    ['a'] = 0x1A, ['b'] = 0x1B, ['c'] = 0x1C, ['d'] = 0x1D, ['e'] = 0x1E, ['f'] = 0x1F
+};
+
+/**
+ * Escapes length bytes of s for HTML into t, which must have room for
+ * escaped(s, length) bytes, copying runs of characters that needn't be
+ * escaped whole, finding each run's end 16 bytes at a time (with SSE2).
+ * Returns number of bytes written (without null-terminating t).
+ */
+size_t escape(char* t, const char* s, size_t length)
+{
+    char* p = t;
+    const char* end = s + length;
+    while (s < end)
+    {
+        // find next character to escape
+        const char* run = s;
+#if defined(__SSE2__)
+        for (; s + 16 <= end; s += 16)
+        {
+            __m128i v = _mm_loadu_si128((const __m128i*) s);
+            __m128i specials = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('&'))),
+                _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\'')), _mm_cmpeq_epi8(v, _mm_set1_epi8('<'))), _mm_cmpeq_epi8(v, _mm_set1_epi8('>'))));
+            unsigned int mask = _mm_movemask_epi8(specials);
+            if (mask != 0)
+            {
+                s += __builtin_ctz(mask);
+                break;
+            }
+        }
+#endif
+        while (s < end && growth[(unsigned char) *s] == 0)
+        {
+            s++;
+        }
+
+        // copy run, then character's entity
+        memcpy(p, run, s - run);
+        p += s - run;
+        if (s < end)
+        {
+            unsigned char ch = *s++;
+            memcpy(p, entities[ch], growth[ch] + 1);
+            p += growth[ch] + 1;
+        }
+    }
+    return p - t;
+}
+
+/**
+ * Counts, 16 bytes at a time (with SSE2), characters in length bytes of s
+ * that HTML requires be escaped. Returns length of s once escaped.
+ */
+size_t escaped(const char* s, size_t length)
+{
+    size_t n = length;
+    const char* end = s + length;
+#if defined(__SSE2__)
+    for (; s + 16 <= end; s += 16)
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*) s);
+        unsigned int amp = _mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('&')));
+        unsigned int quotes = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\''))));
+        unsigned int angles = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('<')), _mm_cmpeq_epi8(v, _mm_set1_epi8('>'))));
+        n += 4 * __builtin_popcount(amp) + 5 * __builtin_popcount(quotes) + 3 * __builtin_popcount(angles);
+    }
+#endif
+    for (; s < end; s++)
+    {
+        n += growth[(unsigned char) *s];
+    }
+    return n;
+}
+
+/**
+ * Hashes length bytes of s with FNV-1a.
+ */
+size_t hash(const char* s, size_t length)
+{
+    size_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < length; i++)
+    {
+        h ^= (unsigned char) s[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Looks up field in head by (case-insensitive) name.
+ * Returns view of field's value if present, else NULL.
+ */
+const view* header(const head* h, const char* name)
+{
+    size_t length = strlen(name);
+    for (int i = 0; i < h->nfields; i++)
+    {
+        if (h->fields[i].name.length == length && strncasecmp(h->fields[i].name.s, name, length) == 0)
+        {
+            return &h->fields[i].value;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Looks at path's extension (after last dot after last slash), case-insensitively,
+ * with one probe of perfect hash table. Returns MIME type for supported
+ * extensions, else NULL.
+ */
+const char* lookup(const char* path)
+{
+    // find extension
+    const char* slash = strrchr(path, '/');
+    const char* dot = strrchr((slash != NULL) ? slash : path, '.');
+    if (dot == NULL || ntypes == 0)
+    {
+        return NULL;
+    }
+    const char* extension = dot + 1;
+
+    // lowercase extension, rejecting any too long to be supported
+    char lower[16];
+    size_t length = strlen(extension);
+    if (length == 0 || length >= sizeof(lower))
+    {
+        return NULL;
+    }
+    for (size_t i = 0; i < length; i++)
+    {
+        lower[i] = tolower((unsigned char) extension[i]);
+    }
+    lower[length] = '\0';
+
+    // probe table at slot determined by hash and bucket's displacement
+    size_t h = hash(lower, length);
+    const mime* m = &types[mix(h, displacements[h % ndisplacements]) & (ntypes - 1)];
+    if (m->extension == NULL || strcmp(m->extension, lower) != 0)
+    {
+        return NULL;
+    }
+    return m->type;
+}
+
+/**
+ * Loads builtin MIME types and those in file at path (whose lines are each a
+ * type followed by its extensions, per mime.types), if not NULL, into a
+ * perfect hash table, using hash and displace: extensions' hashes group them
+ * into buckets, each of which is given a displacement that moves its
+ * extensions into slots not yet taken. Returns true iff successful.
+ */
+bool mimetypes(const char* path)
+{
+    static const mime builtins[] =
+    {
+        {"avif", "image/avif"}, {"bmp", "image/bmp"}, {"css", "text/css"}, {"csv", "text/csv"},
+        {"eot", "application/vnd.ms-fontobject"}, {"flac", "audio/flac"}, {"gif", "image/gif"},
+        {"gz", "application/gzip"}, {"htm", "text/html"}, {"html", "text/html"}, {"ico", "image/x-icon"},
+        {"jpeg", "image/jpeg"}, {"jpg", "image/jpeg"}, {"js", "text/javascript"}, {"json", "application/json"},
+        {"m4a", "audio/mp4"}, {"map", "application/json"}, {"md", "text/markdown"}, {"mjs", "text/javascript"},
+        {"mp3", "audio/mpeg"}, {"mp4", "video/mp4"}, {"oga", "audio/ogg"}, {"ogg", "audio/ogg"},
+        {"ogv", "video/ogg"}, {"otf", "font/otf"}, {"pdf", "application/pdf"}, {"php", "text/x-php"},
+        {"png", "image/png"}, {"svg", "image/svg+xml"}, {"tar", "application/x-tar"}, {"tif", "image/tiff"},
+        {"tiff", "image/tiff"}, {"ttf", "font/ttf"}, {"txt", "text/plain"}, {"wasm", "application/wasm"},
+        {"wav", "audio/wav"}, {"weba", "audio/webm"}, {"webm", "video/webm"},
+        {"webmanifest", "application/manifest+json"}, {"webp", "image/webp"}, {"woff", "font/woff"},
+        {"woff2", "font/woff2"}, {"xml", "application/xml"}, {"zip", "application/zip"}
+    };
+    size_t nbuiltins = sizeof(builtins) / sizeof(builtins[0]);
+
+    // gather builtin types followed by file's, the latter overriding the former
+    mime* all = malloc(nbuiltins * sizeof(mime));
+    if (all == NULL)
+    {
+        return false;
+    }
+    memcpy(all, builtins, nbuiltins * sizeof(mime));
+    size_t n = nbuiltins, capacity = nbuiltins;
+    if (path != NULL)
+    {
+        FILE* file = fopen(path, "r");
+        if (file == NULL)
+        {
+            free(all);
+            return false;
+        }
+        char line[BYTES];
+        while (fgets(line, sizeof(line), file) != NULL)
+        {
+            // skip comments
+            if (line[0] == '#')
+            {
+                continue;
+            }
+            char* saveptr;
+            char* type = strtok_r(line, " \t\r\n", &saveptr);
+            if (type == NULL)
+            {
+                continue;
+            }
+            for (char* extension = strtok_r(NULL, " \t\r\n", &saveptr); extension != NULL; extension = strtok_r(NULL, " \t\r\n", &saveptr))
+            {
+                // PHP's type marks scripts to be interpreted, so keep builtin
+                if (strlen(extension) >= 16 || strcasecmp(extension, "php") == 0)
+                {
+                    continue;
+                }
+                for (char* p = extension; *p != '\0'; p++)
+                {
+                    *p = tolower((unsigned char) *p);
+                }
+                if (n == capacity)
+                {
+                    capacity *= 2;
+                    mime* bigger = realloc(all, capacity * sizeof(mime));
+                    if (bigger == NULL)
+                    {
+                        fclose(file);
+                        free(all);
+                        return false;
+                    }
+                    all = bigger;
+                }
+                all[n].extension = strdup(extension);
+                all[n].type = strdup(type);
+                if (all[n].extension == NULL || all[n].type == NULL)
+                {
+                    fclose(file);
+                    free(all);
+                    return false;
+                }
+                n++;
+            }
+        }
+        fclose(file);
+    }
+
+    // drop any extension that a later one overrides
+    size_t unique = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        bool overridden = false;
+        for (size_t j = i + 1; j < n && !overridden; j++)
+        {
+            overridden = (strcmp(all[i].extension, all[j].extension) == 0);
+        }
+        if (!overridden)
+        {
+            all[unique++] = all[i];
+        }
+    }
+    n = unique;
+
+    // table has a power of two slots, at least 1.25 per extension, and a bucket per 4 extensions
+    for (ntypes = 1; ntypes < n + n / 4; ntypes *= 2);
+    ndisplacements = n / 4 + 1;
+    types = calloc(ntypes, sizeof(mime));
+    displacements = calloc(ndisplacements, sizeof(unsigned int));
+    size_t* hashes = malloc(n * sizeof(size_t));
+    size_t* order = malloc(ndisplacements * sizeof(size_t));
+    size_t* sizes = calloc(ndisplacements, sizeof(size_t));
+    size_t* slots = malloc(n * sizeof(size_t));
+    if (types == NULL || displacements == NULL || hashes == NULL || order == NULL || sizes == NULL || slots == NULL)
+    {
+        return false;
+    }
+
+    // group extensions into buckets by hash
+    for (size_t i = 0; i < n; i++)
+    {
+        hashes[i] = hash(all[i].extension, strlen(all[i].extension));
+        sizes[hashes[i] % ndisplacements]++;
+    }
+
+    // displace largest buckets first, while most slots are free
+    for (size_t i = 0; i < ndisplacements; i++)
+    {
+        size_t j = i;
+        for (; j > 0 && sizes[order[j - 1]] < sizes[i]; j--)
+        {
+            order[j] = order[j - 1];
+        }
+        order[j] = i;
+    }
+    for (size_t i = 0; i < ndisplacements && sizes[order[i]] > 0; i++)
+    {
+        size_t b = order[i];
+
+        // try displacements until every extension in bucket lands in a distinct, free slot
+        for (unsigned int d = 0; ; d++)
+        {
+            if (d == UINT_MAX)
+            {
+                return false;
+            }
+            size_t k = 0;
+            for (size_t e = 0; e < n; e++)
+            {
+                if (hashes[e] % ndisplacements != b)
+                {
+                    continue;
+                }
+                size_t slot = mix(hashes[e], d) & (ntypes - 1);
+                bool taken = (types[slot].extension != NULL);
+                for (size_t l = 0; l < k && !taken; l++)
+                {
+                    taken = (slots[l] == slot);
+                }
+                if (taken)
+                {
+                    break;
+                }
+                slots[k++] = slot;
+            }
+            if (k == sizes[b])
+            {
+                // claim slots
+                displacements[b] = d;
+                k = 0;
+                for (size_t e = 0; e < n; e++)
+                {
+                    if (hashes[e] % ndisplacements == b)
+                    {
+                        types[slots[k++]] = all[e];
+                    }
+                }
+                break;
+            }
+        }
+    }
+    free(all);
+    free(hashes);
+    free(order);
+    free(sizes);
+    free(slots);
+    return true;
+}
+
+/**
+ * Mixes hash h with displacement d, so that each displacement scatters a
+ * bucket's extensions anew.
+ */
+size_t mix(size_t h, unsigned int d)
+{
+    // splitmix64's finalizer
+    h += (d + 1) * 0x9E3779B97F4A7C15ULL;
+    h = (h ^ (h >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    h = (h ^ (h >> 27)) * 0x94D049BB133111EBULL;
+    return h ^ (h >> 31);
+}
+
+/**
+ * Finds first LF in bytes from s to end, examining 32 (with AVX2) or 16 (with
+ * SSE2) bytes at a time. Returns pointer thereto, else end.
+ */
+const BYTE* newline(const BYTE* s, const BYTE* end)
+{
+#if defined(__AVX2__)
+    const __m256i lf32 = _mm256_set1_epi8('\n');
+    for (; s + 32 <= end; s += 32)
+    {
+        unsigned int mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*) s), lf32));
+        if (mask != 0)
+        {
+            return s + __builtin_ctz(mask);
+        }
+    }
+#endif
+#if defined(__SSE2__)
+    const __m128i lf16 = _mm_set1_epi8('\n');
+    for (; s + 16 <= end; s += 16)
+    {
+        unsigned int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*) s), lf16));
+        if (mask != 0)
+        {
+            return s + __builtin_ctz(mask);
+        }
+    }
+#endif
+    for (; s < end; s++)
+    {
+        if (*s == '\n')
+        {
+            return s;
+        }
+    }
+    return end;
+}
+
+/**
+ * Parses the head of a request, whose lines end with CRLFs at the n offsets
+ * in lines (the last of which ends the head's blank line), into views of
+ * message (without copying any of it), storing them in h.
+ * Returns 0 if valid, else the status code with which to respond.
+ */
+unsigned short parse(const char* message, const unsigned int* lines, int n, head* h)
+{
+    // request-line = method SP request-target SP HTTP-version
+    const char* line = message;
+    const char* end = message + lines[0];
+
+    // method, which must be a token
+    const char* sp = memchr(line, ' ', end - line);
+    if (sp == NULL || sp == line)
+    {
+        return 400;
+    }
+    for (const char* p = line; p < sp; p++)
+    {
+        if (!isalnum((unsigned char) *p) && strchr("!#$%&'*+-.^_`|~", *p) == NULL)
+        {
+            return 400;
+        }
+    }
+    h->method.s = line;
+    h->method.length = sp - line;
+
+    // request-target
+    const char* target = sp + 1;
+    sp = memchr(target, ' ', end - target);
+    if (sp == NULL || sp == target)
+    {
+        return 400;
+    }
+    h->target.s = target;
+    h->target.length = sp - target;
+
+    // if target request contains a quotation mark
+    if (memchr(target, '"', sp - target) != NULL)
+    {
+        return 400;
+    }
+
+    // if target does not start with '/' (i.e., isn't absolute-path [ "?" query ])
+    if (*target != '/')
+    {
+        return 501;
+    }
+
+    // split target at first question mark into absolute-path and query
+    const char* question = memchr(target, '?', sp - target);
+    h->path.s = target;
+    h->path.length = ((question != NULL) ? question : sp) - target;
+    h->query.s = (question != NULL) ? question + 1 : sp;
+    h->query.length = sp - h->query.s;
+
+    // check if version is indeed HTTP/1.1 (or HTTP/1.0)
+    const char* version = sp + 1;
+    if (end - version != 8 || memcmp(version, "HTTP/1.", 7) != 0 || (version[7] != '1' && version[7] != '0'))
+    {
+        return 505;
+    }
+    h->version.s = version;
+    h->version.length = 8;
+
+    // header-field = field-name ":" OWS field-value OWS
+    h->nfields = 0;
+    for (int i = 1; i < n - 1; i++)
+    {
+        const char* field = message + lines[i - 1] + 2;
+        const char* end = message + lines[i];
+
+        // field-name, which must be followed immediately by colon (and mustn't be folded onto previous line)
+        const char* colon = memchr(field, ':', end - field);
+        if (colon == NULL || colon == field || colon[-1] == ' ' || colon[-1] == '\t' || *field == ' ' || *field == '\t')
+        {
+            return 400;
+        }
+        h->fields[h->nfields].name.s = field;
+        h->fields[h->nfields].name.length = colon - field;
+
+        // field-value, less surrounding whitespace
+        const char* value = colon + 1;
+        while (value < end && (*value == ' ' || *value == '\t'))
+        {
+            value++;
+        }
+        while (end > value && (end[-1] == ' ' || end[-1] == '\t'))
+        {
+            end--;
+        }
+        h->fields[h->nfields].value.s = value;
+        h->fields[h->nfields].value.length = end - value;
+        h->nfields++;
+    }
+    return 0;
+}
+
+/**
+ * Checks whether connection should persist after responding to the request
+ * whose head is h, per HTTP/1.1's default of keep-alive (and HTTP/1.0's of close).
+ * Returns false if request asks to close connection or has a body (which
+ * isn't supported, so can't be skipped over), else true.
+ */
+bool persistent(const head* h)
+{
+    // Content-Length (other than 0) or Transfer-Encoding
+    const view* length = header(h, "Content-Length");
+    if (length != NULL && strtoul(length->s, NULL, 10) != 0)
+    {
+        return false;
+    }
+    if (header(h, "Transfer-Encoding") != NULL)
+    {
+        return false;
+    }
+
+    // Connection: close (or, for HTTP/1.0, lack of Connection: keep-alive)
+    bool persist = (h->version.s[7] == '1');
+    const view* connection = header(h, "Connection");
+    if (connection != NULL)
+    {
+        const char* end = connection->s + connection->length;
+        for (const char* token = connection->s; token < end; token++)
+        {
+            if (end - token >= 5 && strncasecmp(token, "close", 5) == 0)
+            {
+                return false;
+            }
+            if (end - token >= 10 && strncasecmp(token, "keep-alive", 10) == 0)
+            {
+                persist = true;
+            }
+        }
+    }
+    return persist;
+}
+
+/**
+ * Scans bytes of s from *scanned to length for CRLFs in one pass, appending
+ * offset of each (i.e., of its CR) to lines, of which there are *n and room
+ * for max, and updating *scanned so that scanning can resume once more bytes
+ * arrive. Returns true iff a blank line (CRLF CRLF) has ended a head.
+ */
+bool scan(const BYTE* s, size_t length, size_t* scanned, unsigned int* lines, int* n, int max)
+{
+    const BYTE* end = s + length;
+    for (const BYTE* lf = newline(s + *scanned, end); lf < end; lf = newline(lf + 1, end))
+    {
+        // ignore LFs not preceded by CR
+        if (lf == s || lf[-1] != '\r')
+        {
+            continue;
+        }
+
+        // remember line's end, if room
+        if (*n == max)
+        {
+            *scanned = lf - s;
+            return false;
+        }
+        lines[(*n)++] = lf - 1 - s;
+
+        // blank line ends head
+        if (*n > 1 && lines[*n - 1] == lines[*n - 2] + 2)
+        {
+            *scanned = lf + 1 - s;
+            return true;
+        }
+    }
+    *scanned = length;
+    return false;
+}
+
+/**
+ * URL-decodes length bytes of s, an absolute-path, into t (which must have
+ * room for length + 1 bytes), normalizing it in the same pass by removing
+ * dot-segments (per RFC 3986, section 5.2.4, so that it can't escape root)
+ * and empty segments. A + is left as is, since it means a space only in
+ * a query. Returns pointer to end of (null-terminated) t, else NULL if s
+ * is invalid.
+ */
+char* urldecode(char* t, const char* s, size_t length)
+{
+    if (length == 0 || s[0] != '/')
+    {
+        return NULL;
+    }
+    char* p = t;
+    *p++ = '/';
+
+    // current segment starts just after last slash written
+    char* segment = p;
+    for (size_t i = 1; ; i++)
+    {
+        // decode character, per https://www.ietf.org/rfc/rfc3986.txt, if any remain
+        char ch = '/';
+        if (i < length)
+        {
+            ch = s[i];
+            if (ch == '%')
+            {
+                if (i + 2 >= length || !(hexits[(unsigned char) s[i + 1]] & hexits[(unsigned char) s[i + 2]] & 0x10))
+                {
+                    return NULL;
+                }
+                ch = ((hexits[(unsigned char) s[i + 1]] & 0xF) << 4) | (hexits[(unsigned char) s[i + 2]] & 0xF);
+                i += 2;
+            }
+            if (ch == '\0')
+            {
+                return NULL;
+            }
+        }
+
+        // append anything but a slash to segment
+        if (ch != '/')
+        {
+            *p++ = ch;
+            continue;
+        }
+
+        // segment has ended (as has s, if no characters remain), so drop it
+        // if ., drop it and its parent (if not root) if .., else end it with a slash
+        size_t n = p - segment;
+        if (n == 1 && segment[0] == '.')
+        {
+            p = segment;
+        }
+        else if (n == 2 && segment[0] == '.' && segment[1] == '.')
+        {
+            p = segment;
+            if (p - 1 > t)
+            {
+                for (p--; p[-1] != '/'; p--);
+            }
+        }
+        else if (i >= length)
+        {
+            break;
+        }
+        else if (n > 0)
+        {
+            *p++ = '/';
+        }
+        segment = p;
+        if (i >= length)
+        {
+            break;
+        }
+    }
+    *p = '\0';
+    return p;
+}
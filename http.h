@@ -0,0 +1,76 @@
+//
+// http.h
+//
+// Computer Science 50
+// Problem Set 6
+//
+// parsing and encoding of requests, paths, and filenames, which, needing
+// nothing of server's state, can be linked into (and benchmarked by) others
+//
+
+#ifndef HTTP_H
+#define HTTP_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// constants that specify limits on HTTP requests sizes
+// limits on an HTTP request's size, based on defaults used by Apache's (a popular web server) values
+// http://httpd.apache.org/docs/2.2/mod/core.html
+#define LimitRequestFields 50
+#define LimitRequestFieldSize 4094
+#define LimitRequestLine 8190
+
+// limit on an HTTP request's head (its request-line and fields, each with its CRLF, plus CRLF)
+#define LimitRequestHead (LimitRequestLine + LimitRequestFields * LimitRequestFieldSize + 4)
+
+//constant the specifies how many bytes we’ll eventually be reading into buffers at a time.
+// number of bytes for buffers, below BYTES is an 8-bit char
+#define BYTES 512
+
+// types
+typedef char BYTE;
+
+// a string that isn't null-terminated, such as part of a client's message
+typedef struct view
+{
+    const char* s;
+    size_t length;
+}
+view;
+
+// a request's head, parsed into views of the message that contains it
+typedef struct head
+{
+    view method;
+    view target;
+    view path;
+    view query;
+    view version;
+
+    // fields' names and (trimmed) values, and number thereof
+    struct
+    {
+        view name;
+        view value;
+    }
+    fields[LimitRequestFields];
+    int nfields;
+}
+head;
+
+// prototypes
+size_t escape(char* t, const char* s, size_t length);
+size_t escaped(const char* s, size_t length);
+size_t hash(const char* s, size_t length);
+const view* header(const head* h, const char* name);
+const char* lookup(const char* path);
+bool mimetypes(const char* path);
+size_t mix(size_t h, unsigned int d);
+const BYTE* newline(const BYTE* s, const BYTE* end);
+unsigned short parse(const char* message, const unsigned int* lines, int n, head* h);
+bool persistent(const head* h);
+bool scan(const BYTE* s, size_t length, size_t* scanned, unsigned int* lines, int* n, int max);
+char* urldecode(char* t, const char* s, size_t length);
+
+#endif
@@ -0,0 +1,439 @@
+//
+// micro.c
+//
+// Computer Science 50
+// Problem Set 6
+//
+// micro-benchmarks of http.c's functions, each run over a fixed corpus of
+// realistic inputs, reporting time and cycles, throughput, and allocations
+// per call
+//
+
+// feature test macro requirements
+#define _GNU_SOURCE
+
+// default number of milliseconds for which to run each benchmark
+#define MILLISECONDS 200
+
+// header files
+#include <limits.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+// time-stamp counter, for counting cycles
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "http.h"
+
+// a benchmark: function's name, and a pass over its corpus, which returns
+// number of bytes it processed, and number of calls that a pass makes
+typedef struct benchmark
+{
+    const char* name;
+    size_t (*pass)(void);
+    int calls;
+}
+benchmark;
+
+// prototypes
+size_t decoding(void);
+size_t escaping(void);
+size_t finding(void);
+size_t looking(void);
+size_t measure(const benchmark* b, long milliseconds);
+size_t parsing(void);
+size_t persisting(void);
+size_t scanning(void);
+uint64_t ticks(void);
+void* __real_calloc(size_t n, size_t size);
+void* __real_malloc(size_t size);
+void* __real_realloc(void* p, size_t size);
+void* __wrap_calloc(size_t n, size_t size);
+void* __wrap_malloc(size_t size);
+void* __wrap_realloc(void* p, size_t size);
+
+// requests' heads, as sent by a browser, by a command-line client, by an old
+// client, and by a form (for a script), all typical of what server parses
+const char* requests[] =
+{
+    "GET /images/photos/2024/IMG_0042.jpg HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "sec-ch-ua: \"Chromium\";v=\"124\", \"Google Chrome\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+    "sec-ch-ua-mobile: ?0\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+    "sec-ch-ua-platform: \"Linux\"\r\n"
+    "Accept: image/avif,image/webp,image/apng,image/svg+xml,image/*,*/*;q=0.8\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "Sec-Fetch-Mode: no-cors\r\n"
+    "Sec-Fetch-Dest: image\r\n"
+    "Referer: http://localhost:8080/gallery.php?album=2024&page=3\r\n"
+    "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "If-None-Match: \"1a2b3c-4d5e6f-6612ab34\"\r\n"
+    "If-Modified-Since: Sun, 07 Apr 2024 12:34:56 GMT\r\n"
+    "\r\n",
+
+    "GET /index.html HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: curl/8.5.0\r\n"
+    "Accept: */*\r\n"
+    "\r\n",
+
+    "GET / HTTP/1.0\r\n"
+    "\r\n",
+
+    "GET /search.php?q=caf%C3%A9+au+lait&lang=fr&page=2 HTTP/1.1\r\n"
+    "Host: localhost:8080\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 14_4) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.4 Safari/605.1.15\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Accept-Language: fr-FR,fr;q=0.9\r\n"
+    "Accept-Encoding: gzip, deflate, br\r\n"
+    "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark; consent=1\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+};
+
+// request-targets' paths, percent-encoded, some with dot-segments
+const char* paths[] =
+{
+    "/",
+    "/index.html",
+    "/css/site.min.css",
+    "/images/photos/2024/IMG_0042.jpg",
+    "/docs/Annual%20Report%20(2023)%20-%20Final.pdf",
+    "/caf%C3%A9/men%C3%BC/cr%C3%A8me+br%C3%BBl%C3%A9e.html",
+    "/a/b/c/../../d/./e/f/../g.txt",
+    "/assets/vendor/node_modules/some-library/dist/esm/components/button/index.module.js"
+};
+
+// names of files, as listed (escaped) and as typed (looked up by extension)
+const char* filenames[] =
+{
+    "index.html",
+    "README",
+    "site.min.css",
+    "IMG_0042.JPG",
+    "Annual Report (2023) - Final.pdf",
+    "O'Reilly & Sons <draft> \"v2\".txt",
+    "archive.tar.gz",
+    "font.woff2",
+    "manifest.webmanifest",
+    "notes.xyz"
+};
+
+// sizes of corpora
+#define NREQUESTS (sizeof(requests) / sizeof(requests[0]))
+#define NPATHS (sizeof(paths) / sizeof(paths[0]))
+#define NFILENAMES (sizeof(filenames) / sizeof(filenames[0]))
+
+// requests' heads, scanned (and parsed) once in advance, for benchmarks of later steps
+unsigned int lines[NREQUESTS][LimitRequestFields + 2];
+int nlines[NREQUESTS];
+head heads[NREQUESTS];
+
+// number of allocations made thus far
+size_t allocations = 0;
+
+// results, which benchmarks accumulate so that their calls can't be optimized away
+volatile size_t sink = 0;
+
+int main(int argc, char* argv[])
+{
+    // usage
+    const char* usage = "Usage: micro [-t milliseconds] [function ...]";
+
+    // parse command-line arguments
+    long milliseconds = MILLISECONDS;
+    int opt;
+    while ((opt = getopt(argc, argv, "ht:")) != -1)
+    {
+        switch (opt)
+        {
+            // -h
+            case 'h':
+                printf("%s\n", usage);
+                return 0;
+
+            // -t milliseconds
+            case 't':
+                milliseconds = atol(optarg);
+                break;
+
+            default:
+                printf("%s\n", usage);
+                return 2;
+        }
+    }
+    if (milliseconds < 1)
+    {
+        printf("%s\n", usage);
+        return 2;
+    }
+
+    // load builtin MIME types
+    if (!mimetypes(NULL))
+    {
+        printf("Could not load MIME types\n");
+        return 1;
+    }
+
+    // scan and parse requests in advance
+    for (int i = 0; i < NREQUESTS; i++)
+    {
+        size_t scanned = 0;
+        if (!scan(requests[i], strlen(requests[i]), &scanned, lines[i], &nlines[i], LimitRequestFields + 2)
+            || parse(requests[i], lines[i], nlines[i], &heads[i]) != 0)
+        {
+            printf("Could not parse request %i\n", i);
+            return 1;
+        }
+    }
+
+    // benchmarks
+    const benchmark benchmarks[] =
+    {
+        {"scan", scanning, NREQUESTS},
+        {"parse", parsing, NREQUESTS},
+        {"header", finding, 3 * NREQUESTS},
+        {"persistent", persisting, NREQUESTS},
+        {"urldecode", decoding, NPATHS},
+        {"escape", escaping, NFILENAMES},
+        {"lookup", looking, NFILENAMES}
+    };
+
+    // run those named, else all
+    printf("%-18s %10s %10s %10s %10s\n", "function", "ns/call", "cycles", "MB/s", "allocs");
+    for (int i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++)
+    {
+        bool named = (optind == argc);
+        for (int j = optind; j < argc && !named; j++)
+        {
+            named = (strcmp(argv[j], benchmarks[i].name) == 0);
+        }
+        if (named)
+        {
+            measure(&benchmarks[i], milliseconds);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Decodes each of paths. Returns number of bytes decoded.
+ */
+size_t decoding(void)
+{
+    size_t bytes = 0;
+    char t[LimitRequestLine + 1];
+    for (int i = 0; i < NPATHS; i++)
+    {
+        size_t length = strlen(paths[i]);
+        char* end = urldecode(t, paths[i], length);
+        sink += (end != NULL) ? end - t : 0;
+        bytes += length;
+    }
+    return bytes;
+}
+
+/**
+ * Escapes each of filenames, as a listing does, sizing each with escaped()
+ * before escaping it into a buffer with room for any name. Returns number
+ * of bytes escaped.
+ */
+size_t escaping(void)
+{
+    size_t bytes = 0;
+    char t[6 * NAME_MAX + 1];
+    for (int i = 0; i < NFILENAMES; i++)
+    {
+        size_t length = strlen(filenames[i]);
+        if (escaped(filenames[i], length) < sizeof(t))
+        {
+            t[escape(t, filenames[i], length)] = '\0';
+            sink += t[0];
+        }
+        bytes += length;
+    }
+    return bytes;
+}
+
+/**
+ * Finds in each of heads a field that's usually present, one that's present
+ * only in some, and one that's never present. Returns number of bytes of
+ * fields' names compared.
+ */
+size_t finding(void)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < NREQUESTS; i++)
+    {
+        sink += (header(&heads[i], "Host") != NULL);
+        sink += (header(&heads[i], "Accept-Encoding") != NULL);
+        sink += (header(&heads[i], "Transfer-Encoding") != NULL);
+        for (int j = 0; j < heads[i].nfields; j++)
+        {
+            bytes += 3 * heads[i].fields[j].name.length;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * Looks up MIME type of each of filenames. Returns number of bytes of names looked up.
+ */
+size_t looking(void)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < NFILENAMES; i++)
+    {
+        sink += (lookup(filenames[i]) != NULL);
+        bytes += strlen(filenames[i]);
+    }
+    return bytes;
+}
+
+/**
+ * Runs passes of benchmark for about milliseconds, then reports its mean
+ * time, cycles, and allocations per call, and its throughput. Returns
+ * number of calls made.
+ */
+size_t measure(const benchmark* b, long milliseconds)
+{
+    // warm caches and branch predictors
+    b->pass();
+
+    // run passes in batches, each twice as long as last, until time's up
+    size_t passes = 0, bytes = 0, batch = 1;
+    size_t before = allocations;
+    uint64_t cycles = ticks();
+    struct timespec start, now;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    double elapsed = 0;
+    while (elapsed < milliseconds / 1e3)
+    {
+        for (size_t i = 0; i < batch; i++)
+        {
+            bytes += b->pass();
+        }
+        passes += batch;
+        batch *= 2;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        elapsed = (now.tv_sec - start.tv_sec) + (now.tv_nsec - start.tv_nsec) / 1e9;
+    }
+    cycles = ticks() - cycles;
+    size_t allocated = allocations - before;
+
+    // report per call
+    size_t calls = passes * b->calls;
+    printf("%-18s %10.1f ", b->name, elapsed * 1e9 / calls);
+    if (cycles != 0)
+    {
+        printf("%10.1f ", (double) cycles / calls);
+    }
+    else
+    {
+        printf("%10s ", "-");
+    }
+    printf("%10.1f %10.2f\n", bytes / elapsed / (1024 * 1024), (double) allocated / calls);
+    return calls;
+}
+
+/**
+ * Parses each of requests' (already scanned) heads. Returns number of bytes parsed.
+ */
+size_t parsing(void)
+{
+    size_t bytes = 0;
+    head h;
+    for (int i = 0; i < NREQUESTS; i++)
+    {
+        sink += parse(requests[i], lines[i], nlines[i], &h);
+        sink += h.nfields;
+        bytes += lines[i][nlines[i] - 1] + 2;
+    }
+    return bytes;
+}
+
+/**
+ * Decides whether each of heads' connections persists. Returns number of
+ * bytes of heads' fields' names compared.
+ */
+size_t persisting(void)
+{
+    size_t bytes = 0;
+    for (int i = 0; i < NREQUESTS; i++)
+    {
+        sink += persistent(&heads[i]);
+        for (int j = 0; j < heads[i].nfields; j++)
+        {
+            bytes += 3 * heads[i].fields[j].name.length;
+        }
+    }
+    return bytes;
+}
+
+/**
+ * Scans each of requests for its lines' CRLFs, as request does once
+ * a head has arrived whole. Returns number of bytes scanned.
+ */
+size_t scanning(void)
+{
+    size_t bytes = 0;
+    unsigned int found[LimitRequestFields + 2];
+    for (int i = 0; i < NREQUESTS; i++)
+    {
+        size_t length = strlen(requests[i]), scanned = 0;
+        int n = 0;
+        sink += scan(requests[i], length, &scanned, found, &n, LimitRequestFields + 2);
+        bytes += scanned;
+    }
+    return bytes;
+}
+
+/**
+ * Returns value of time-stamp counter, if any, else 0.
+ */
+uint64_t ticks(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * Counts an allocation, then makes it with libc's calloc. (The linker
+ * routes calls to calloc here, per --wrap.)
+ */
+void* __wrap_calloc(size_t n, size_t size)
+{
+    allocations++;
+    return __real_calloc(n, size);
+}
+
+/**
+ * Counts an allocation, then makes it with libc's malloc.
+ */
+void* __wrap_malloc(size_t size)
+{
+    allocations++;
+    return __real_malloc(size);
+}
+
+/**
+ * Counts an allocation, then makes it with libc's realloc.
+ */
+void* __wrap_realloc(void* p, size_t size)
+{
+    allocations++;
+    return __real_realloc(p, size);
+}
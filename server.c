@@ -7,73 +7,671 @@
 
 // feature test macro requirements
 //these allow us to use certain functions that are declared (conditionally) in the header files further below.
-//#define _GNU_SOURCE
+#define _GNU_SOURCE
 //#define _XOPEN_SOURCE 700
 //#define _XOPEN_SOURCE_EXTENDED
 
-// constants that specify limits on HTTP requests sizes
-// limits on an HTTP request's size, based on defaults used by Apache's (a popular web server) values
-// http://httpd.apache.org/docs/2.2/mod/core.html
-#define LimitRequestFields 50
-#define LimitRequestFieldSize 4094
-#define LimitRequestLine 8190
+// maximum number of events to handle per call to epoll_wait
+#define EVENTS 64
 
-//constant the specifies how many bytes we’ll eventually be reading into buffers at a time.
-// number of bytes for buffers, below BYTES is an 8-bit char
-#define BYTES 512
+// number of seconds for which a connection may idle between requests, and
+// within which a request's head, once begun, must arrive in whole
+#define KEEPALIVE 5
+#define HEADER 20
+
+// number of bytes in each connection's arena, from which its requests' scratch
+// memory is allocated, and alignment of each allocation therefrom
+#define ARENA 16384
+#define ALIGNMENT 16
+
+// maximum number of receive buffers (and of arenas) that a worker keeps for reuse
+#define POOL 64
+
+// number of bytes in each receive buffer, until a request's head needs more
+// (up to LimitRequestHead + 1), which most never do
+#define BUFFER 8192
+
+// default number of bytes of files to cache in memory, shared evenly among workers
+#define CACHE (64 * 1024 * 1024)
+
+// number of php-cgi processes to start per worker, if server starts php-cgi
+#define CHILDREN 4
+
+// number of entries in a worker's cache of paths' metadata, how many of them
+// may be of paths that don't exist, and number of seconds for which each is trusted
+#define METAS 4096
+#define NEGATIVES 1024
+#define TTL 2
+
+// number of entries in each worker's io_uring submission queue, and maximum
+// number of bytes of a file to read (into a client's output) at once therewith
+#define RING 256
+#define CHUNK (64 * 1024)
+
+// maximum number of ranges that a request may specify (beyond which its
+// Range header is ignored), boundary between them in a multipart/byteranges
+// response, and number of bytes for a file's entity-tag
+#define RANGES 16
+#define BOUNDARY "3d6b6e2a0f5c41b7"
+#define TAG 64
+
+// content codings that server can send, in order of preference, number
+// thereof, and smallest file worth compressing on the fly
+#define BROTLI 0
+#define ZSTD 1
+#define GZIP 2
+#define CODINGS 3
+#define SMALLEST 256
+
+// maximum number of idle connections to FastCGI server that a worker keeps for reuse
+#define UPSTREAMS 16
+
+// number of seconds within which FastCGI server must accept a request and
+// start responding, and thereafter send each more of its response
+#define GATEWAY 30
+
+// maximum length of a FastCGI record's content
+#define RECORD 65535
+
+// number of bytes of a script's output to queue for a client before pausing
+// reads from FastCGI server until client catches up
+#define WATERMARK (256 * 1024)
+
+// levels of what's logged, each including those before it
+#define LOG_ERROR 0
+#define LOG_WARNING 1
+#define LOG_INFO 2
+#define LOG_DEBUG 3
+
+// number of notes in each worker's journal (of accesses and messages to be
+// logged), most bytes of each note's text, number of milliseconds between
+// scribe's flushes of journals, and most bytes that scribe writes at once
+#define JOURNAL 8192
+#define NOTE 104
+#define FLUSH 10
+#define BATCH (64 * 1024)
+
+// debugging traces, compiled out of release builds (i.e., with NDEBUG defined, as by make release)
+#if defined(NDEBUG)
+#define TRACE(...)
+#else
+#define TRACE(...) say(LOG_DEBUG, __VA_ARGS__)
+#endif
+
+// stages of serving a request whose latencies are measured (if metrics are
+// exposed), number thereof, and number of buckets in each's histogram, the
+// first of which is bounded by 2^SHIFT nanoseconds, each thereafter by twice
+// as many, and the last not at all
+#define STAGE_CONNECT 0
+#define STAGE_READ 1
+#define STAGE_PARSE 2
+#define STAGE_RESOLVE 3
+#define STAGE_TRANSFER 4
+#define STAGE_INTERPRET 5
+#define STAGE_RESPOND 6
+#define STAGE_SERVE 7
+#define STAGES 8
+#define BINS 24
+#define SHIFT 8
+
+// FastCGI record types
+// https://fast-cgi.github.io/spec
+#define FCGI_BEGIN_REQUEST 1
+#define FCGI_END_REQUEST 3
+#define FCGI_PARAMS 4
+#define FCGI_STDIN 5
+#define FCGI_STDOUT 6
+#define FCGI_STDERR 7
 
 // header files
 #include <arpa/inet.h>
 #include <dirent.h>
 #include <errno.h> // a global variable used by quite a few functions to indicate (via an int), in cases of error, precisely which error has occurred
+#include <fcntl.h>
 #include <limits.h>
-#include <math.h>
+#include <linux/io_uring.h>
+#include <linux/openat2.h>
 #include <signal.h>
+#include <stdarg.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <pthread.h>
 #include <string.h>
 #include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/syscall.h>
 #include <sys/types.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <time.h>
 #include <unistd.h>
 #include <ctype.h>
 
+// compression libraries, for encoding files on the fly
+#include <brotli/encode.h>
+#include <zlib.h>
+
+// parsing and encoding of requests, paths, and filenames
+#include "http.h"
+
 // types
-typedef char BYTE;
+// a content coding: its token, suffix of files precompressed therewith, and
+// whether server can compress therewith on the fly
+typedef struct coding
+{
+    const char* token;
+    const char* suffix;
+    bool dynamic;
+}
+coding;
+
+// a file cached in memory, along with the headers that precede it in a response
+typedef struct entry
+{
+    // local path of file (the entry's key) and hash thereof
+    char* path;
+    size_t hash;
+
+    // file's MIME type, and index of content coding of its response (-1 if none)
+    const char* type;
+    int coding;
+
+    // Content-Type, Content-Length, and validators' headers, CRLF, and file's
+    // content, which starts at offset
+    BYTE* response;
+    size_t length;
+    size_t offset;
+
+    // file's entity-tag (empty for a listing, which has no validators) and modification time
+    char tag[TAG];
+    time_t modified;
+
+    // number of clients still sending response, and whether entry has been
+    // evicted from cache (and so is to be freed once no client is)
+    int refs;
+    bool evicted;
+
+    // next entry in same bucket of cache's hash table
+    struct entry* next;
+
+    // neighbors in cache's list of entries, from most to least recently used
+    struct entry* newer;
+    struct entry* older;
+}
+entry;
+
+// a range of a file's bytes, first through last
+typedef struct range
+{
+    off_t first;
+    off_t last;
+}
+range;
+
+// a block of memory from which a connection allocates by bumping an offset,
+// all at once reset after each request
+typedef struct arena
+{
+    // next arena in worker's spares, or, while in use, block that this one outgrew
+    struct arena* next;
+
+    // number of bytes allocated thus far and available in all
+    size_t used;
+    size_t capacity;
+
+    BYTE bytes[];
+}
+arena;
+
+// what's known of a path: whether it exists, and, if so, whether it's a
+// directory (and, if so, its index's name, if any) or a file (and, if so,
+// its size, modification time, and MIME type)
+typedef struct meta
+{
+    // local path (the entry's key), length and hash thereof, and when entry expires
+    char* path;
+    size_t length;
+    size_t hash;
+    time_t expires;
+
+    bool exists;
+    bool directory;
+    const char* index;
+    off_t size;
+    time_t mtime;
+    const char* type;
+}
+meta;
+
+// an access to be logged (a request's method and target, in text, its
+// response's status code and size, and number of microseconds taken to
+// respond) or, if status is 0, a message (in text) to be logged at level
+typedef struct note
+{
+    time_t time;
+    unsigned int duration;
+    unsigned short status;
+    unsigned char level;
+    size_t bytes;
+    char text[NOTE];
+}
+note;
+
+// a worker's notes, appended (by worker) at tail and consumed (by scribe)
+// at head, each on its own cache line, along with number of notes dropped
+// because journal was full
+typedef struct journal
+{
+    note notes[JOURNAL];
+    _Alignas(64) size_t head;
+    _Alignas(64) size_t tail;
+    size_t dropped;
+}
+journal;
+
+// a worker's statistics, each updated by worker alone (but stored atomically,
+// so that whichever worker exposes metrics can read them without a lock):
+// responses by status code and their bytes, connections opened and closed,
+// hits and misses of cache of files and of cache of paths' metadata, and
+// each stage's latencies (a histogram thereof and their sum, in nanoseconds)
+typedef struct ledger
+{
+    size_t statuses[600];
+    size_t bytes;
+    size_t opened;
+    size_t closed;
+    size_t hits;
+    size_t misses;
+    size_t recalls;
+    size_t lapses;
+    size_t latencies[STAGES][BINS];
+    size_t nanoseconds[STAGES];
+}
+ledger;
+
+// state of a client's connection, one per socket multiplexed by the event loop
+typedef struct client
+{
+    // client's socket
+    int fd;
+
+    // bytes read from socket thus far, into a buffer (of mcapacity bytes,
+    // BUFFER unless grown) borrowed from worker's pool, and how many of them
+    // have already been scanned for CRLFs
+    BYTE* message;
+    size_t length;
+    size_t mcapacity;
+    size_t scanned;
+
+    // offsets of CRLFs in message (one per line of request's head, the
+    // request-line's first), and number thereof
+    unsigned int lines[LimitRequestFields + 2];
+    int nlines;
+
+    // length of head of request at start of message (through its last
+    // field's CRLF), once complete, any bytes thereafter being later requests
+    size_t end;
+
+    // head of request, once parsed
+    head head;
+
+    // local path requested, in a buffer (kept for reuse) that starts with root
+    char* path;
+
+    // arena for current request's scratch memory, borrowed from worker's
+    // spares (or heap), if any, and number of bytes allocated therefrom
+    arena* arena;
+    size_t allocated;
+
+    // bytes queued for socket and how many of them have already been written
+    BYTE* output;
+    size_t size;
+    size_t capacity;
+    size_t offset;
+
+    // cached response to be sent once output has been written, if any,
+    // along with number of its bytes already sent
+    entry* entry;
+    size_t sent;
+
+    // file to be sent (with sendfile, or read into output with io_uring) once
+    // output has been written, if any, along with position of and number of
+    // bytes remaining to be sent, and whether a read thereof is in flight
+    int file;
+    off_t position;
+    size_t remaining;
+    bool reading;
+
+    // file's ranges, if being sent as parts of a multipart/byteranges
+    // response, number thereof, index of next part, and file's type and size
+    range ranges[RANGES];
+    int nranges;
+    int part;
+    const char* type;
+    off_t total;
+
+    // socket connected to FastCGI server for script being interpreted, if
+    // any, whether it was reused from worker's idle connections, and number
+    // of bytes read from it thus far
+    int cgi;
+    bool reused;
+    size_t received;
+
+    // FastCGI request's records and how many of them have already been written to server
+    BYTE* records;
+    size_t rsize;
+    size_t rcapacity;
+    size_t roffset;
+
+    // header of FastCGI record being read, number of its bytes read thus far,
+    // and number of bytes of record's content and padding yet to be read
+    unsigned char header[8];
+    size_t hlength;
+    size_t content;
+    size_t padding;
+
+    // script's CGI headers parsed thus far (each with a CRLF, save those that
+    // frame a response), followed by a partial line starting at offset line
+    // (and, before then, request's params)
+    BYTE* script;
+    size_t ssize;
+    size_t scapacity;
+    size_t line;
+
+    // response's status code (once known), whether its head has been sent,
+    // and whether its body is being sent in chunks
+    unsigned short status;
+    bool started;
+    bool chunked;
+
+    // whether response's body is to be omitted (because request's method is HEAD)
+    bool bodiless;
+
+    // whether to close connection once output has been written
+    bool closing;
+
+    // whether client has been disconnected (and so awaits reuse)
+    bool disconnected;
+
+    // second (of monotonic clock) by which client must send (rest of) a
+    // request's head, or FastCGI server more of script's output, lest sweep
+    // close connection (or respond with 504) (0 if neither is awaited), and
+    // whether some of that head has arrived
+    time_t deadline;
+    bool heading;
+
+    // when serving of request began, and its access, once responded to, if
+    // not yet logged (because response is still being generated by a script)
+    struct timespec began;
+    note note;
+
+    // next client in list of clients available for reuse
+    struct client* next;
+
+    // neighbors in worker's list of connected clients, from most to least recently connected
+    struct client* newer;
+    struct client* older;
+}
+client;
+
+// a worker thread, with its own listening socket and event loop
+typedef struct worker
+{
+    pthread_t thread;
+    int sfd;
+
+    // most bytes that any one request has allocated from its arena, and
+    // number of requests that outgrew ARENA bytes
+    size_t peak;
+    size_t overflows;
+
+    // notes to be logged by scribe, if any
+    journal* journal;
+
+    // statistics, exposed as metrics
+    ledger* ledger;
+}
+worker;
+
+// a worker's io_uring instance, by which it reads files without blocking:
+// its descriptor, eventfd signaled upon completions, and its rings (shared
+// with kernel) of submissions and completions
+typedef struct ring
+{
+    int fd;
+    int event;
+    unsigned* sqhead;
+    unsigned* sqtail;
+    unsigned* sqmask;
+    unsigned* sqarray;
+    struct io_uring_sqe* sqes;
+    unsigned* cqhead;
+    unsigned* cqtail;
+    unsigned* cqmask;
+    struct io_uring_cqe* cqes;
+}
+ring;
 
 // prototypes
+int accepted(client* c);
+void account(client* c, unsigned short code, size_t bytes);
+bool acquire(client* c);
+entry* admit(const char* path, const char* type, BYTE* response, size_t length);
+void* allocate(client* c, size_t size);
+bool append(client* c, const void* bytes, size_t length);
+void await(client* c);
+int bounds(client* c, off_t size, const char* tag, time_t modified);
+bool cached(client* c, const char* path);
+bool canonical(const char* path);
+void changed(void);
+bool chunk(client* c, const BYTE* bytes, size_t length);
+int compare(const void* a, const void* b);
+void completed(void);
+bool compressible(const char* type);
+bool conditional(client* c, const char* tag, time_t modified, const char* type, off_t size, const BYTE* content, int file, int coding);
 bool connected(void);
-void error(unsigned short code);
-void freedir(struct dirent** namelist, int n);
+void count(size_t* counter, size_t n);
+view date(void);
+int delimiter(char* s, size_t size, const client* c, int i);
+void deliver(client* c, entry* e);
+int describe(char* s, size_t size, const char* type, int coding, const char* tag, time_t modified);
+int dial(void);
+void disconnect(client* c);
+void drain(journal* j, char* batch);
+size_t emit(client* c, const struct iovec* iov, int n, bool more);
+entry* encode(entry* e, int accepts);
+void error(client* c, unsigned short code);
+void etag(char* tag, const struct stat* sb, int coding);
+void evict(entry* e);
+void expose(client* c);
+bool extend(BYTE** buffer, size_t* size, size_t* capacity, const void* bytes, size_t length);
+entry* find(const char* path, size_t hash);
+bool flush(client* c);
+void forget(const char* path, size_t length);
+bool forward(client* c, const BYTE* bytes, size_t length);
+bool fresh(client* c, const char* tag, time_t modified);
 void handler(int signal);
-char* htmlspecialchars(const char* s);
-char* indexes(const char* path);
-void interpret(const char* path, const char* query);
-void list(const char* path);
-bool load(FILE* file, BYTE** content, size_t* length);
-const char* lookup(const char* path);
-bool parse(const char* line, char* path, char* query);
+void hangup(client* c, bool keep);
+time_t hence(int seconds);
+int indexes(int dir, char* path, const char** name);
+entry* insert(const char* path, const char* type, int file, const struct stat* sb, int coding);
+void interpret(client* c, const char* path, view query);
+bool jot(const note* n);
+void list(client* c, int file, const char* path);
+bool matches(view list, const char* tag);
+uint64_t observe(int stage, uint64_t since);
+bool pair(client* c, const char* name, size_t nlength, const char* value, size_t vlength);
+void post(client* c);
+bool prepare(void);
+void prerender(void);
+bool process(client* c);
+void purge(const char* path);
+size_t queue(client* c, const struct iovec* iov, int n, size_t written);
 const char* reason(unsigned short code);
-void redirect(const char* uri);
-bool request(char** message, size_t* length);
-void respond(int code, const char* headers, const char* body, size_t length);
-void start(short port, const char* path);
+meta* recall(const char* path, size_t length);
+bool record(client* c, unsigned char type, const BYTE* content, size_t length);
+void redirect(client* c, const char* uri);
+int relay(client* c);
+void release(entry* e);
+void relinquish(client* c);
+void remember(const char* path, size_t length, const meta* facts);
+int request(client* c);
+bool reserve(BYTE** buffer, size_t* capacity, size_t size);
+void reset(client* c, bool keep);
+int resolve(int dir, const char* path);
+void respond(client* c, int code, const struct iovec* headers, int n, const BYTE* body, size_t length);
+void say(int level, const char* format, ...);
+void* scribe(void* arg);
+void serve(client* c);
+int sibling(client* c, const char* path, time_t modified, int coding, struct stat* sb);
+void slash(client* c, view path);
+void spawn(int children);
+BYTE* squeeze(int coding, const BYTE* bytes, size_t length, size_t* n);
+void start(short port, const char* path, int n);
 void stop(void);
-void transfer(const char* path, const char* type);
-char* urldecode(const char* s);
+void stream(client* c, int file, const struct stat* sb, const char* path, const char* type, int coding);
+bool submit(client* c);
+void sweep(void);
+uint64_t tick(void);
+bool timestamp(view v, time_t* t);
+size_t transcribe(char* t, size_t size, view v);
+void transfer(client* c, int file, const struct stat* sb, const char* path, const char* type);
+bool upstream(client* c, bool reuse);
+int validators(char* s, size_t size, const char* tag, time_t modified, int coding);
+bool variant(char* key, size_t size, const char* path, int coding);
+bool watch(const char* path);
+void* work(void* arg);
 
 // server's root.. a pointer to the string that represents the root of the server. 
 // ex: public root would be a pointer to that public directory
+// set once by start, before any worker runs, and only read thereafter, as is its length
 char* root = NULL;
+size_t rootlength = 0;
+
+// root's directory, relative to which every request's path is opened
+int rfd = -1;
+
+// workers, each of which owns a socket bound (with SO_REUSEPORT) to the server's port
+worker* workers = NULL;
+int nworkers = 0;
+
+// eventfd by which workers are told to stop
+int wfd = -1;
+
+// number of bytes of files to cache in memory, shared evenly among workers
+size_t budget = CACHE;
+
+// whether workers should read files with io_uring (if supported) instead of sending them with sendfile
+bool uring = false;
+
+// path of FastCGI server's socket, and ID of php-cgi's process, if started by server
+char* fastcgi = NULL;
+pid_t php = 0;
+
+// path at which metrics are exposed, if any (without which stages aren't timed), and its length
+char* metrics = NULL;
+size_t metricslength = 0;
 
-// file descriptor for sockets. similar to file* fp... reads from network connections 
-// that use integers instead of pointers. They are global to keep track of ct file descriptor
-int cfd = -1, sfd = -1;
+// name of each stage whose latencies are measured
+const char* stages[STAGES] = {"connect", "read", "parse", "resolve", "transfer", "interpret", "respond", "serve"};
+
+// content codings that server can send, in order of preference
+const coding codings[CODINGS] =
+{
+    [BROTLI] = {"br", ".br", true}, [ZSTD] = {"zstd", ".zst", false}, [GZIP] = {"gzip", ".gz", true}
+};
+
+// Status-Line for each status code with a reason phrase, serialized by start
+view statuses[600];
+
+// response to each error (4xx or 5xx) with a reason phrase, less Status-Line
+// and Date (i.e., Content-Type and Content-Length headers, CRLF, and content),
+// rendered by start
+view errors[600];
+
+// this worker's file descriptors for its server socket and for the epoll
+// instance that multiplexes it and every one of its clients' sockets
+_Thread_local int efd = -1, sfd = -1;
+
+// this worker's Date header and the second in which it was formatted
+_Thread_local char dateline[64];
+_Thread_local size_t datelength = 0;
+_Thread_local time_t dated = 0;
+
+// this worker's clients whose connections have been closed, available for reuse
+_Thread_local client* clients = NULL;
+
+// this worker's clients disconnected while handling epoll's latest events,
+// not to be reused until all are handled, lest some of them be for these clients
+_Thread_local client* departed = NULL;
+
+// this worker's connected clients, from most to least recently connected,
+// and second (of monotonic clock) in which sweep last checked their deadlines
+_Thread_local client* connections = NULL;
+_Thread_local time_t swept = 0;
+
+// this worker's receive buffers not in use by any client, each of whose
+// first bytes point to the next, and number thereof
+_Thread_local BYTE* buffers = NULL;
+_Thread_local int nbuffers = 0;
+
+// this worker's arenas not in use by any client, and number thereof
+_Thread_local arena* spares = NULL;
+_Thread_local int nspares = 0;
+
+// this worker (whose statistics it alone updates)
+_Thread_local worker* self = NULL;
+
+// when epoll last woke this worker, which is when serving of requests then ready began
+_Thread_local struct timespec woke;
+
+// this worker's cache of paths' metadata (a hash table, one entry per
+// bucket), and number of its entries of paths that don't exist
+_Thread_local meta* metas = NULL;
+_Thread_local int nnegatives = 0;
+
+// this worker's io_uring instance, if any
+_Thread_local ring io = {.fd = -1, .event = -1};
+
+// this worker's idle connections to FastCGI server, kept for reuse, and number thereof
+_Thread_local int idle[UPSTREAMS];
+_Thread_local int nidle = 0;
+
+// this worker's buffer for records read from FastCGI server
+_Thread_local BYTE inbound[RECORD + 1];
+
+// this worker's cache of files: a hash table of entries (chained), a list of
+// them from most to least recently used, their total size, and its budget
+_Thread_local entry** buckets = NULL;
+_Thread_local size_t nbuckets = 0, nentries = 0;
+_Thread_local entry* newest = NULL;
+_Thread_local entry* oldest = NULL;
+_Thread_local size_t cachesize = 0, share = 0;
+
+// this worker's inotify instance, by which its cache learns of changes to
+// files under root, and directories watched thereby (indexed by watch descriptor)
+_Thread_local int ifd = -1;
+_Thread_local char** watches = NULL;
+_Thread_local int nwatches = 0;
 
 // flag indicating whether control-c has been heard. 
-bool signaled = false;
+volatile sig_atomic_t signaled = false;
+
+// level of what's logged, which SIGUSR1 raises and SIGUSR2 lowers, and each level's name
+volatile sig_atomic_t verbosity = LOG_INFO;
+const char* levels[] = {"error", "warning", "info", "debug"};
+
+// thread that logs workers' journals, and whether it should keep doing so
+pthread_t writer;
+bool writing = false;
 
 int main(int argc, char* argv[])
 {
@@ -85,32 +683,81 @@ int main(int argc, char* argv[])
     // default to port 8080
     int port = 8080;
 
+    // default to one worker
+    int n = 1;
+
     // usage
-    const char* usage = "Usage: server [-p port] /path/to/root";
+    const char* usage = "Usage: server [-c bytes] [-f socket] [-l error|warning|info|debug] [-m mime.types] [-p port] [-s /metrics] [-u] [-w workers] /path/to/root";
+
+    // file of MIME types, if any, in addition to builtin types
+    const char* file = NULL;
 
     // parse command-line arguments
     int opt;
     // getopt a function declared in unistd.h that makes it easier to parse command-line arguments.
-    while ((opt = getopt(argc, argv, "hp:")) != -1)
+    while ((opt = getopt(argc, argv, "c:f:hl:m:p:s:uw:")) != -1)
     {
         switch (opt)
         {
+            // -c bytes
+            case 'c':
+                budget = strtoull(optarg, NULL, 10);
+                break;
+
+            // -f socket
+            case 'f':
+                fastcgi = optarg;
+                break;
+
             // -h
             case 'h':
                 printf("%s\n", usage);
                 return 0;
 
+            // -l level
+            case 'l':
+                verbosity = -1;
+                for (int i = LOG_ERROR; i <= LOG_DEBUG; i++)
+                {
+                    if (strcmp(optarg, levels[i]) == 0)
+                    {
+                        verbosity = i;
+                    }
+                }
+                break;
+
+            // -m mime.types
+            case 'm':
+                file = optarg;
+                break;
+
             // -p port
             case 'p':
 
                 port = atoi(optarg);
 
                 break;
+
+            // -s path
+            case 's':
+                metrics = optarg;
+                metricslength = strlen(optarg);
+                break;
+
+            // -u
+            case 'u':
+                uring = true;
+                break;
+
+            // -w workers
+            case 'w':
+                n = atoi(optarg);
+                break;
         }
     }
 
-    // ensure port is non-negative and path to server's root is specified
-    if (port < 0 || port > SHRT_MAX || argv[optind] == NULL || strlen(argv[optind]) == 0)
+    // ensure port is non-negative, there's at least one worker, level is known, metrics' path (if any) is absolute, and path to server's root is specified
+    if (port < 0 || port > SHRT_MAX || n < 1 || verbosity < LOG_ERROR || (metrics != NULL && metrics[0] != '/') || argv[optind] == NULL || strlen(argv[optind]) == 0)
     {
         // announce usage
         printf("%s\n", usage);
@@ -118,8 +765,12 @@ int main(int argc, char* argv[])
         return 2;
     }
 
-    // start server// magic happens
-    start(port, argv[optind]);
+    // load MIME types
+    if (!mimetypes(file))
+    {
+        printf("Could not load %s\n", file);
+        return 1;
+    }
 
     // listen for SIGINT (aka control-c) //listen for a signal if control c, function called handler that stops program
     struct sigaction act;
@@ -128,1226 +779,4470 @@ int main(int argc, char* argv[])
     sigemptyset(&act.sa_mask);
     sigaction(SIGINT, &act, NULL);
 
-    // a message and its length
-    char* message = NULL;
-    size_t length = 0;
+    // listen for SIGUSR1 and SIGUSR2, which raise and lower level of what's logged
+    sigaction(SIGUSR1, &act, NULL);
+    sigaction(SIGUSR2, &act, NULL);
 
-    // path requested
-    char* path = NULL;
+    // ignore SIGPIPE, so that sending to a client who's closed connection fails with EPIPE instead of killing server
+    act.sa_handler = SIG_IGN;
+    sigaction(SIGPIPE, &act, NULL);
 
-    // accept connections one at a time 
-    // loops infinitely, waiting for someone to connect/waiting for true to be returned by this function
-    while (true)
+    // block SIGINT (and SIGUSR1 and SIGUSR2) so that workers, which inherit this mask, never handle it
+    sigset_t mask, unblocked;
+    sigemptyset(&mask);
+    sigaddset(&mask, SIGINT);
+    sigaddset(&mask, SIGUSR1);
+    sigaddset(&mask, SIGUSR2);
+    pthread_sigmask(SIG_BLOCK, &mask, &unblocked);
+
+    // start server// magic happens
+    start(port, argv[optind], n);
+
+    // wait for control-c
+    while (!signaled)
     {
-        // free last path, if any that might have been allocated by previous iteration of loop
-        if (path != NULL)
-        {
-            printf("146 path= [%s]\n", path);
-            free(path);
-            path = NULL;
-        }
+        sigsuspend(&unblocked);
+    }
+
+    // tell workers to stop, then wait for them to do so
+    uint64_t one = 1;
+    if (write(wfd, &one, sizeof(one)) == -1)
+    {
+        stop();
+    }
+    for (int i = 0; i < nworkers; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+
+    // log what remains of workers' journals
+    if (__atomic_exchange_n(&writing, false, __ATOMIC_ACQ_REL))
+    {
+        pthread_join(writer, NULL);
+    }
+
+    // report how much of their arenas requests have used, so that ARENA can be sized
+    for (int i = 0; i < nworkers; i++)
+    {
+        say(LOG_INFO, "worker %i: arena high-water %zu of %i bytes, %zu requests outgrew it", i, workers[i].peak, ARENA, workers[i].overflows);
+    }
+    stop();
+}
 
-        // free last message, if any
-        if (message != NULL)
+/**
+ * Parses client's Accept-Encoding header, if any. Returns a bitmask of
+ * content codings (1 << index of each) that client accepts.
+ */
+int accepted(client* c)
+{
+    const view* v = header(&c->head, "Accept-Encoding");
+    if (v == NULL)
+    {
+        return 0;
+    }
+    int accepts = 0;
+    const char* p = v->s;
+    const char* end = v->s + v->length;
+    while (p < end)
+    {
+        // skip whitespace and empty elements
+        if (*p == ' ' || *p == '\t' || *p == ',')
         {
-            // printf("153 message= [%s]\n", message);
-            free(message);
-            message = NULL;
+            p++;
+            continue;
         }
-        length = 0;
 
-        // close last client's socket, if any
-        if (cfd != -1)
+        // read coding's token
+        const char* token = p;
+        while (p < end && *p != ',' && *p != ';' && *p != ' ' && *p != '\t')
         {
-            printf("162 cfd= [%i]\n", cfd);
-            close(cfd);
-            cfd = -1;
+            p++;
         }
-
-        // check for control-c
-        if (signaled)
+        size_t length = p - token;
+        if (length == 6 && strncasecmp(token, "x-gzip", 6) == 0)
         {
-            printf("171 stop signaled");
-            stop();
+            token += 2;
+            length -= 2;
         }
 
-        // check whether client has connected 
-        // function they wrote, loops infinitely, waiting for true to be returned by that function
-        // if a ct or browser or even curl has connected to the server
-        if (connected())
-        {
-            // check for request // takes whatever is inside virtual envelope (http request), 
-            // parses initial request top to bottom left to right, loads all of intial lines 
-            // into a variable called message and load its length into length. 
-            // the request(function) takes two arguments, message and length. they both have &infront. 
-            // scroll up, message and length are declared inside of main to be a char* and a size_t (an int).
-            // message is a char* but I'm passing in &, i'm getting the address of a pointer... a double pointer. 
-            // scroll down.. the reqeust function returns a bool. char** because i want this function request to 
-            // allocate memory for however big the http request from the virtual envelope that it receives from the browser 
-            // I want to be able to return a string but i also want to be able to return a length. 
-            // you can return two values if you pass in two values by reference or by pointer 
-            // so you can go to those addresses, put values there. message = char**, as soon as you go there with *message, 
-            // you're going to find a chunk of memory that should be a char* or the address of a string
-            if(request(&message, &length))
-            {
-                printf("188 request function called\n");
-                // extract message's request-line
-                // http://www.w3.org/Protocols/rfc2616/rfc2616-sec5.html // the following will be useful in your own parse function. strstr allows you to search for one string in another, this is their way of searching for the end of a line so that I can read just one line into memory. 
-                const char* haystack = message;
-                // printf("198 haystack = [%s]\n", haystack);
-                const char* needle = strstr(haystack, "\r\n");
-                // printf("200 needle = [%s]\n", needle);
-                if (needle == NULL)
+        // read its parameters, of which only q matters, since q=0 refuses coding
+        bool refused = false;
+        while (p < end && *p != ',')
+        {
+            if ((*p == 'q' || *p == 'Q') && end - p >= 2 && p[1] == '=')
+            {
+                p += 2;
+                refused = (p < end && *p == '0');
+                while (p < end && (*p == '0' || *p == '.'))
                 {
-                    printf("203 (approx line) error 500 perhaps something wrong with needle/haystack\n");
-                    error(500);
-                    continue;
+                    p++;
                 }
-                char line[needle - haystack + 2 + 1]; // allocate memory for the request (haystack - needle)
-                // (make memory for the line)
-                strncpy(line, haystack, needle - haystack + 2);
-                // line[needle - haystack + 2] = '\0'; // store in this array, that first line
-
-                // log request-line
-                printf("211 request-line: [%s]\n", line);
-
-                // parse request-line // the purpose is to take the very first line and extract the absolute path and query. 
-                // request target is a string that can be broken up into two parts absolute-path like hello.html followed by 
-                // an optional question mark
-                char abs_path[LimitRequestLine + 1];
-                // printf("215 abs_path(before parse) = [%s]\n", abs_path);
-                // going to add null terminator in parse instead
-                // abs_path[0] = '\0';
-                // printf("219 abs_path(before parse, after appending null terminator) = [%s]\n", abs_path);
-                char query[LimitRequestLine + 1];
-                if (parse(line, abs_path, query))
+                if (p < end && isdigit((unsigned char) *p))
                 {
-                    printf("223 result from parse... abs_path= [%s], query string = [%s]\n", abs_path, query);
-                    // URL-decode absolute-path
-                    char* p = urldecode(abs_path); // in case the browser has encoded characters in a special way, it turns it back to ascii characters
-                    if (p == NULL)
-                    {
-                        printf("error from parse, approx line 224\n");
-                        error(500);
-                        continue;
-                    }
-
-                    // resolve absolute-path to local path 
-                    // if user has requested /hello.html, what file do they really mean? take root of server, 
-                    // that path to the public directory and concatenate it with something like hello.html so we have 
-                    // one bigger string that leads us exactly to the hello.html file on cs50 ide harddrive or disk
-                    // path = malloc(strlen(root) + strlen(p) + 1);
-                    // length of ../server.c (no idea if this will work)
-                    // path = malloc(16 + strlen(p) + 1);
-                    path = malloc(strlen(root) + strlen(p) + 1);
-                    // printf("240 path = [%s]\n", path); it was empty []
-                    if (path == NULL)
-                    {
-                        printf("error 500 parse failed, approx line 243\n");
-                        error(500);
-                        continue;
-                    }
-                    //printf("247 root = [%s]\n", root);
-                    strcpy(path, root);
-                    // printf("249 path = [%s]\n", path);
-                    printf("250 p = [%s]\n", p);
-
-                    // hard-coding the path for now
-                    // this affects how much memory to malloc
-                    strcat(path, p);
-
-                    free(p);
-
-                    // printf("249 ***root from request/parse = [%s]\n", root);
-                    printf("250 ***path from request/parse = [%s]\n", path);
-                    printf("251 ***abs_path from request/parse = [%s]\n", abs_path);
-
-                    // ensure path exists
-                    if (access(path, F_OK) == -1)
-                    {
-                        printf("256 path = [%s]\n", path);
-                        printf("257 error 404 parse failed, path does not exist\n");
-                        error(404);
-                        continue;
-                    }
-
-                    // if path to directory 
-                    // has user requested a file or a directory? force user to be redirected to not 'foo' but 'foo/'
-                    struct stat sb;
-                    //printf("line 253 if(stat(path... about to be invoked. Below is indexes\n");
-                    if (stat(path, &sb) == 0 && S_ISDIR(sb.st_mode))
-                    {
-                        // redirect from absolute-path to absolute-path/
-                        if (abs_path[strlen(abs_path) - 1] != '/')
-                        {
-                            char uri[strlen(abs_path) + 1 + 1];
-                            strcpy(uri, abs_path);
-                            strcat(uri, "/");
-                            redirect(uri);
-                            continue;
-                        }
-
-                        // use path/index.php or path/index.html, if present, instead of directory's path 
-                        // if user has visited a directory and that directory contains a file called index.html or .php, 
-                        // we don't want to show them the contents of that directory, we want to show them the contents of 
-                        // that default file index.html or .php. this function called index checks "is there a file in here 
-                        // called index.html or .php?"
-                        //printf("indexes (approx 271) about to be called\n");
-                        char* index = indexes(path); 
-                        if (index != NULL)
-                        {
-                            //printf("index value (line 276) = [%s]\n", index);
-                            //printf("index value should be /home/ubuntu/workspace/pset6/public/index.html, not blank!\n");
-                            free(path);
-                            path = index;
-                            //printf("path value (line 276) = [%s]\n", path);
-                        }
-                        // list contents of directory
-                        else
-                        {
-                            printf("else loop executed (line 286ish)\n");
-                            list(path);
-                            continue;
-                        }
-                        //printf("line 290 if(stat(path... invoked. Did indexes get called?\n");
-                    }
-
-                    // look up MIME type for file at path 
-                    // if user requests is not for a directory but for a file, lookup function tell the 
-                    // server is this a jpeg? is this a gif? 
-                    //printf("lookup, approx 298, called\n");
-                    const char* type = lookup(path);
-                    if (type == NULL)
-                    {
-                        printf("error from 302: const char* type = lookup(path), type == NULL\n");
-                        error(501);
-                        continue;
-                    }
-                    else
-                    {
-                        printf("from call to lookup in 304\n");
-                        printf("type = %s, if != 501, call to lookup successfull, type != NULL\n", type);
-                    }
-                    // interpret PHP script at path 
-                    // if the above is true, this will say is it a php file? then call function called interpret (staff wrote
-                    // it interprets php file and spits out results
-                    if (strcasecmp("text/x-php", type) == 0)
-                    {
-                        printf("query called approx 312\n");
-                        interpret(path, query);
-                    }
-                    // if it's anything else, transfer the file from the server to the user as if they requested an html page, img, etc
-                    // transfer file at path
-                    else
-                    {
-                        transfer(path, type);
-                    }
+                    refused = false;
                 }
+                continue;
+            }
+            p++;
+        }
+        for (int i = 0; i < CODINGS && !refused; i++)
+        {
+            if (length == strlen(codings[i].token) && strncasecmp(token, codings[i].token, length) == 0)
+            {
+                accepts |= 1 << i;
             }
         }
     }
+    return accepts;
 }
 
 /**
- * Checks (without blocking) whether a client has connected to server. 
- * Returns true iff so.
+ * Counts a response with status code code and bytes bytes, then notes, as
+ * client's pending note, an access: client's request (whose request-line
+ * serve noted), to which server so responded, if accesses are logged. (The
+ * note is logged by post.)
  */
-bool connected(void)
+void account(client* c, unsigned short code, size_t bytes)
 {
-    struct sockaddr_in cli_addr;
-    memset(&cli_addr, 0, sizeof(cli_addr));
-    socklen_t cli_len = sizeof(cli_addr);
-    cfd = accept(sfd, (struct sockaddr*) &cli_addr, &cli_len);
-    if (cfd == -1)
+    count(&self->ledger->statuses[code], 1);
+    count(&self->ledger->bytes, bytes);
+    if (verbosity < LOG_INFO)
     {
-        return false;
+        return;
+    }
+    c->note.status = code;
+    c->note.level = LOG_INFO;
+    c->note.bytes = bytes;
+}
+
+/**
+ * Borrows a receive buffer from worker's pool (or heap) for client's message.
+ * Returns true iff successful.
+ */
+bool acquire(client* c)
+{
+    if (buffers != NULL)
+    {
+        c->message = buffers;
+        memcpy(&buffers, buffers, sizeof(BYTE*));
+        nbuffers--;
+    }
+    else
+    {
+        c->message = malloc(BUFFER);
+        if (c->message == NULL)
+        {
+            return false;
+        }
     }
+    c->mcapacity = BUFFER;
     return true;
 }
 
 /**
- * Responds to client with specified status code.
+ * Adds to cache an entry for path with specified type and response (headers
+ * and content), which cache henceforth owns, making room within budget.
+ * Returns entry, else NULL (having freed response).
  */
-void error(unsigned short code)
+entry* admit(const char* path, const char* type, BYTE* response, size_t length)
 {
-    // determine code's reason-phrase
-    const char* phrase = reason(code);
-    if (phrase == NULL)
+    // allocate entry
+    entry* e = malloc(sizeof(entry));
+    if (e == NULL)
     {
-        return;
+        free(response);
+        return NULL;
     }
+    e->path = strdup(path);
+    if (e->path == NULL)
+    {
+        free(response);
+        free(e);
+        return NULL;
+    }
+    e->type = type;
+    e->response = response;
+    e->length = length;
+    e->coding = -1;
+    e->offset = 0;
+    e->tag[0] = '\0';
+    e->modified = 0;
 
-    // template for response's content
-    char* template = "<html><head><title>%i %s</title></head><body><h1>%i %s</h1></body></html>";
+    // make room within budget
+    while (cachesize + e->length > share && oldest != NULL)
+    {
+        evict(oldest);
+    }
 
-    // render template
-    char body[(strlen(template) - 2 - ((int) log10(code) + 1) - 2 + strlen(phrase)) * 2 + 1];
-    int length = sprintf(body, template, code, phrase, code, phrase);
-    if (length < 0)
+    // grow hash table as needed, keeping it no more than fully loaded
+    if (nentries + 1 > nbuckets)
     {
-        body[0] = '\0';
-        length = 0;
+        size_t n = (nbuckets == 0) ? 64 : nbuckets * 2;
+        entry** b = calloc(n, sizeof(entry*));
+        if (b == NULL)
+        {
+            free(e->path);
+            free(e->response);
+            free(e);
+            return NULL;
+        }
+        for (size_t i = 0; i < nbuckets; i++)
+        {
+            while (buckets[i] != NULL)
+            {
+                entry* next = buckets[i]->next;
+                buckets[i]->next = b[buckets[i]->hash & (n - 1)];
+                b[buckets[i]->hash & (n - 1)] = buckets[i];
+                buckets[i] = next;
+            }
+        }
+        free(buckets);
+        buckets = b;
+        nbuckets = n;
     }
 
-    // respond with error
-    char* headers = "Content-Type: text/html\r\n";
-    respond(code, headers, body, length);
+    // add to hash table and to front of list
+    e->hash = hash(path, strlen(path));
+    e->refs = 0;
+    e->evicted = false;
+    e->next = buckets[e->hash & (nbuckets - 1)];
+    buckets[e->hash & (nbuckets - 1)] = e;
+    nentries++;
+    e->newer = NULL;
+    e->older = newest;
+    if (newest != NULL)
+    {
+        newest->newer = e;
+    }
+    newest = e;
+    if (oldest == NULL)
+    {
+        oldest = e;
+    }
+    cachesize += e->length;
+    return e;
 }
 
 /**
- * Frees memory allocated by scandir.
- * facilitate freeing memory that’s allocated by a function called scandir that we call in list.
+ * Allocates size bytes (aligned) for client's current request from its arena,
+ * borrowing one from worker's spares if client has none, and chaining another
+ * block (of ARENA bytes, unless size is more) if arena's been outgrown.
+ * Returns pointer to memory, valid until reset, else NULL.
  */
-void freedir(struct dirent** namelist, int n)
+void* allocate(client* c, size_t size)
 {
-    if (namelist != NULL)
+    // round size up, lest later allocations be misaligned
+    size = (size + ALIGNMENT - 1) & ~(size_t) (ALIGNMENT - 1);
+
+    // borrow an arena if client has none
+    if (c->arena == NULL && spares != NULL)
     {
-        for (int i = 0; i < n; i++)
+        c->arena = spares;
+        spares = spares->next;
+        nspares--;
+        c->arena->next = NULL;
+        c->arena->used = 0;
+    }
+
+    // chain another block if arena can't fit size
+    arena* a = c->arena;
+    if (a == NULL || a->used + size > a->capacity)
+    {
+        size_t capacity = (size > ARENA) ? size : ARENA;
+        a = malloc(sizeof(arena) + capacity);
+        if (a == NULL)
         {
-            free(namelist[i]);
+            return NULL;
         }
-        free(namelist);
+        a->next = c->arena;
+        a->used = 0;
+        a->capacity = capacity;
+        c->arena = a;
     }
+
+    // bump
+    void* p = a->bytes + a->used;
+    a->used += size;
+    c->allocated += size;
+    return p;
 }
- 
+
 /**
- * Handles signals.
+ * Appends bytes to client's output, to be written to its socket by flush.
+ * Returns true iff successful.
  */
-void handler(int signal)
+bool append(client* c, const void* bytes, size_t length)
 {
-    // if user hits control-c
-    if (signal == SIGINT)
-    {
-        signaled = true;
-    }
+    return extend(&c->output, &c->size, &c->capacity, bytes, length);
 }
 
 /**
- * Escapes string for HTML. Returns dynamically allocated memory for escaped
- * string that must be deallocated by caller.
+ * Gives client, whose next request's head has yet to arrive in whole, until a
+ * deadline to send it: KEEPALIVE seconds hence, if none of it has arrived,
+ * else HEADER seconds since some first did (however slowly the rest trickles in).
  */
-char* htmlspecialchars(const char* s)
+void await(client* c)
 {
-    // ensure s is not NULL
-    if (s == NULL)
+    if (c->length == 0)
     {
-        return NULL;
+        c->deadline = hence(KEEPALIVE);
+        c->heading = false;
     }
-
-    // allocate enough space for an unescaped copy of s
-    char* t = malloc(strlen(s) + 1);
-    if (t == NULL)
+    else if (!c->heading)
     {
-        return NULL;
+        c->deadline = hence(HEADER);
+        c->heading = true;
     }
-    t[0] = '\0';
+}
 
-    // iterate over characters in s, escaping as needed
-    for (int i = 0, old = strlen(s), new = old; i < old; i++)
+/**
+ * Parses client's Range header, if any (and unless If-Range names another
+ * version of file than tag or modified), into client's ranges of a file of
+ * size bytes, omitting unsatisfiable ones. Returns number of ranges, 0 if
+ * file is to be sent whole, or -1 if no range is satisfiable.
+ */
+int bounds(client* c, off_t size, const char* tag, time_t modified)
+{
+    const view* v = header(&c->head, "Range");
+    if (v == NULL || v->length < 6 || strncasecmp(v->s, "bytes=", 6) != 0)
+    {
+        return 0;
+    }
+
+    // ignore Range unless If-Range, if any, matches (strongly) file's entity-tag or modification time
+    const view* w = header(&c->head, "If-Range");
+    if (w != NULL)
     {
-        // escape &
-        if (s[i] == '&')
+        time_t t;
+        if (w->length > 0 && w->s[0] == '"' ? (w->length != strlen(tag) || memcmp(w->s, tag, w->length) != 0) :
+            (!timestamp(*w, &t) || t != modified))
         {
-            const char* entity = "&amp;";
-            new += strlen(entity);
-            t = realloc(t, new);
-            if (t == NULL)
-            {
-                return NULL;
-            }
-            strcat(t, entity);
+            return 0;
         }
+    }
 
-        // escape "
-        else if (s[i] == '"')
+    // parse comma-separated list of first-last, first-, and -suffix
+    int n = 0, specified = 0;
+    const char* p = v->s + 6;
+    const char* end = v->s + v->length;
+    while (p < end)
+    {
+        // skip whitespace and empty elements
+        if (*p == ' ' || *p == '\t' || *p == ',')
         {
-            const char* entity = "&quot;";
-            new += strlen(entity);
-            t = realloc(t, new);
-            if (t == NULL)
-            {
-                return NULL;
-            }
-            strcat(t, entity);
+            p++;
+            continue;
         }
-
-        // escape '
-        else if (s[i] == '\'')
+        if (++specified > RANGES)
         {
-            const char* entity = "&#039;";
-            new += strlen(entity);
-            t = realloc(t, new);
-            if (t == NULL)
+            return 0;
+        }
+        off_t first = -1, last = -1;
+        if (*p != '-')
+        {
+            if (!isdigit((unsigned char) *p))
             {
-                return NULL;
+                return 0;
+            }
+            for (first = 0; p < end && isdigit((unsigned char) *p) && first <= (LLONG_MAX - 9) / 10; p++)
+            {
+                first = first * 10 + (*p - '0');
             }
-            strcat(t, entity);
         }
-
-        // escape <
-        else if (s[i] == '<')
+        if (p == end || *p != '-')
+        {
+            return 0;
+        }
+        p++;
+        if (p < end && isdigit((unsigned char) *p))
         {
-            const char* entity = "&lt;";
-            new += strlen(entity);
-            t = realloc(t, new);
-            if (t == NULL)
+            for (last = 0; p < end && isdigit((unsigned char) *p) && last <= (LLONG_MAX - 9) / 10; p++)
             {
-                return NULL;
+                last = last * 10 + (*p - '0');
             }
-            strcat(t, entity);
+        }
+        if (p < end && *p != ',' && *p != ' ' && *p != '\t')
+        {
+            return 0;
         }
 
-        // escape >
-        else if (s[i] == '>')
+        // -suffix means last suffix bytes
+        if (first == -1)
         {
-            const char* entity = "&gt;";
-            new += strlen(entity);
-            t = realloc(t, new);
-            if (t == NULL)
+            if (last == -1)
             {
-                return NULL;
+                return 0;
+            }
+            if (last == 0)
+            {
+                continue;
             }
-            strcat(t, entity);
+            first = (last < size) ? size - last : 0;
+            last = size - 1;
+        }
+        else if (last != -1 && last < first)
+        {
+            return 0;
+        }
+        else if (last == -1 || last >= size)
+        {
+            last = size - 1;
         }
 
-        // don't escape
-        else
+        // omit ranges that start beyond file
+        if (first >= size)
         {
-            strncat(t, s + i, 1);
+            continue;
         }
+        c->ranges[n].first = first;
+        c->ranges[n].last = last;
+        n++;
     }
-    // escaped string
-    return t;
+    return (specified == 0) ? 0 : (n == 0) ? -1 : n;
 }
 
 /**
- * Checks, in order, whether index.php or index.html exists inside of path.
- * Returns path to first match if so, else NULL.
+ * Responds to client with cached copy of file (or listing) at path, if any,
+ * preferring a variant encoded per a content coding that client accepts
+ * (compressing one now, if need be). Returns true iff responded.
  */
-char* indexes(const char* path)
+bool cached(client* c, const char* path)
 {
-    int length = strlen(path);
-    const char* phpPath = "index.php";
-    char* phpString = malloc(length + 9);
-    strcat(phpString, path);
-    strcat(phpString, phpPath);
-        
-    if(access(phpString, F_OK) == -1)
+    entry* e = find(path, hash(path, strlen(path)));
+    int accepts = accepted(c);
+    if (accepts != 0 && (e == NULL || compressible(e->type)))
     {
-        // TODO: free phpString here 
-        // phpString = NULL;
-        free(phpString);
-        //printf("indexes function(approx 511) called... path (printed from indexes ~ ) = %s\n", path);   
-        const char* htmlPath = "index.html";
-        char* htmlString = malloc(length + 10);
-        strcat(htmlString, path);
-        strcat(htmlString, htmlPath);
-        
-        if(access(htmlString, F_OK) == -1)
+        // respond with a cached variant, if any
+        char key[PATH_MAX + 8];
+        for (int i = 0; i < CODINGS; i++)
         {
-            printf("error 403 indexes failed (access(phpString + htmlString, F_OK)), approx line 523\n");
-            printf("if != index.php or index.html, error 403 is what we want... approx line 523\n");
-            error(403);
-            htmlString = NULL;
-            return NULL;  
+            entry* v;
+            if ((accepts & (1 << i)) && variant(key, sizeof(key), path, i) &&
+                (v = find(key, hash(key, strlen(key)))) != NULL)
+            {
+                deliver(c, v);
+                return true;
+            }
         }
-        else
+
+        // else compress file now, caching variant
+        if (e != NULL)
         {
-            printf("returning htmlString = [%s] (approx 558), \n", htmlString);   
-            return htmlString;
+            entry* v = encode(e, accepts);
+            if (v != NULL)
+            {
+                deliver(c, v);
+                return true;
+            }
+
+            // file may have been evicted to make room for a variant that couldn't be
+            e = find(path, hash(path, strlen(path)));
         }
     }
-    else
+    if (e == NULL)
     {
-        printf("returning phpString = [%s] (approx 558), \n", phpString);   
-        return phpString;
+        return false;
     }
+    deliver(c, e);
+    return true;
 }
 
 /**
- * Interprets PHP file at path using query string.
+ * Returns true iff path is canonical (but for a trailing slash, if any), lest
+ * inotify report changes to what it names by another name.
  */
-void interpret(const char* path, const char* query)
+bool canonical(const char* path)
 {
-    // ensure path is readable
-    if (access(path, R_OK) == -1)
+    char* real = realpath(path, NULL);
+    if (real == NULL)
     {
-        error(403);
-        return;
+        return false;
     }
+    size_t n = strlen(real);
+    bool same = (strncmp(real, path, n) == 0 && (path[n] == '\0' || (path[n] == '/' && path[n + 1] == '\0')));
+    free(real);
+    return same;
+}
 
-    // open pipe to PHP interpreter
-    char* format = "QUERY_STRING=\"%s\" REDIRECT_STATUS=200 SCRIPT_FILENAME=\"%s\" php-cgi";
-    char command[strlen(format) + (strlen(path) - 2) + (strlen(query) - 2) + 1];
-    if (sprintf(command, format, query, path) < 0)
-    {
-        printf("error 500 interpret failed, approx line 586\n");
-        error(500);
-        return;
-    }
-    FILE* file = popen(command, "r");
-    if (file == NULL)
+/**
+ * Invalidates cached copies of files that inotify reports have changed.
+ */
+void changed(void)
+{
+    // events are aligned as for struct inotify_event
+    BYTE buffer[sizeof(struct inotify_event) + NAME_MAX + 1] __attribute__((aligned(__alignof__(struct inotify_event))));
+    while (true)
     {
-        printf("error 500 interpret failed, approx line 593\n");
-        error(500);
-        return;
-    }
+        ssize_t bytes = read(ifd, buffer, sizeof(buffer));
+        if (bytes <= 0)
+        {
+            return;
+        }
+        for (BYTE* p = buffer; p < buffer + bytes; p += sizeof(struct inotify_event) + ((struct inotify_event*) p)->len)
+        {
+            struct inotify_event* event = (struct inotify_event*) p;
 
-    // load interpreter's content
-    char* content;
-    size_t length;
-    printf("load about to be invoked from interpret function, 601\n");
-    if (load(file, &content, &length) == false)
-    {
-        printf("error 500 (perhaps load in interpret failed), approx line 604\n");
-        error(500);
-        return;
-    }
-    else
-    {
-         printf("call to load (in interpret function) was successful\n");
-    }
+            // forget directory whose watch kernel has removed
+            if (event->mask & IN_IGNORED)
+            {
+                if (event->wd < nwatches && watches[event->wd] != NULL)
+                {
+                    free(watches[event->wd]);
+                    watches[event->wd] = NULL;
+                }
+                continue;
+            }
 
-    // close pipe
-    pclose(file);
+            // if events were lost or a directory was moved or deleted, any entry could be stale, so start over
+            if ((event->mask & (IN_Q_OVERFLOW | IN_DELETE_SELF | IN_MOVE_SELF)) ||
+                ((event->mask & IN_ISDIR) && (event->mask & (IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO))))
+            {
+                while (oldest != NULL)
+                {
+                    evict(oldest);
+                }
+                for (int i = 0; i < METAS && metas != NULL; i++)
+                {
+                    if (metas[i].path != NULL)
+                    {
+                        forget(metas[i].path, metas[i].length);
+                    }
+                }
+                for (int i = 0; i < nwatches; i++)
+                {
+                    if (watches[i] != NULL)
+                    {
+                        inotify_rm_watch(ifd, i);
+                        free(watches[i]);
+                        watches[i] = NULL;
+                    }
+                }
+                if (!watch(root))
+                {
+                    share = 0;
+                }
+                continue;
+            }
+            if (event->wd >= nwatches || watches[event->wd] == NULL)
+            {
+                continue;
+            }
 
-    // subtract php-cgi's headers from content's length to get body's length
-    char* haystack = content;
-    char* needle = strstr(haystack, "\r\n\r\n");
-    if (needle == NULL)
-    {
-        free(content);
-        printf("error 500 interpret failed, approx line 622\n");
-        error(500);
-        return;
-    }
+            // invalidate directory's listing and metadata (e.g., its index), if any,
+            // since something within (or it) changed
+            char path[PATH_MAX];
+            if (snprintf(path, sizeof(path), "%s/", watches[event->wd]) < sizeof(path))
+            {
+                purge(path);
+                forget(path, strlen(path) - 1);
+            }
+            if (event->len == 0)
+            {
+                continue;
+            }
+
+            // forget file's (or directory's) metadata (including that it didn't exist, if so)
+            if (snprintf(path, sizeof(path), "%s/%s", watches[event->wd], event->name) >= sizeof(path))
+            {
+                continue;
+            }
+            forget(path, strlen(path));
 
-    // extract headers
-    char headers[needle + 2 - haystack + 1];
-    strncpy(headers, content, needle + 2 - haystack);
-    headers[needle + 2 - haystack] = '\0';
+            // watch new directory (and anything already created within it)
+            if ((event->mask & IN_CREATE) && (event->mask & IN_ISDIR))
+            {
+                if (!watch(path))
+                {
+                    // can't learn of changes within it, so stop caching
+                    while (oldest != NULL)
+                    {
+                        evict(oldest);
+                    }
+                    share = 0;
+                }
+                continue;
+            }
 
-    // respond with interpreter's content
-    respond(200, headers, needle + 4, length - (needle - haystack + 4));
+            // invalidate file's entry and variants, if any, and, if file is a
+            // precompressed sibling of another, that file's variants
+            purge(path);
+            for (int i = 0; i < CODINGS; i++)
+            {
+                size_t length = strlen(path), n = strlen(codings[i].suffix);
+                if (length > n && strcmp(path + length - n, codings[i].suffix) == 0)
+                {
+                    path[length - n] = '\0';
+                    purge(path);
+                    break;
+                }
+            }
+        }
+    }
+}
 
-    // free interpreter's content
-    free(content);
+/**
+ * Appends bytes to client's output as one chunk, per HTTP/1.1's chunked
+ * transfer coding, or, if length is 0, as last chunk. Returns true iff successful.
+ */
+bool chunk(client* c, const BYTE* bytes, size_t length)
+{
+    char size[32];
+    int n = (length > 0) ? sprintf(size, "%zx\r\n", length) : sprintf(size, "0\r\n\r\n");
+    return append(c, size, n) && append(c, bytes, length) && (length == 0 || append(c, "\r\n", 2));
 }
 
 /**
- * Responds to client with directory listing of path.
+ * Compares, for qsort, names pointed to by a and b, byte by byte.
  */
-void list(const char* path)
+int compare(const void* a, const void* b)
 {
-    // ensure path is readable and executable
-    if (access(path, R_OK | X_OK) == -1)
-    {
-        error(403);
-        return;
-    }
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
 
-    // open directory
-    DIR* dir = opendir(path);
-    if (dir == NULL)
+/**
+ * Reaps completions from worker's io_uring instance, each a read of a file
+ * into a client's output, sending what was read (and reading more).
+ */
+void completed(void)
+{
+    // reset eventfd
+    uint64_t n;
+    if (read(io.event, &n, sizeof(n)) == -1 && errno != EAGAIN)
     {
         return;
     }
 
-    // buffer for list items
-    char* list = malloc(1);
-    list[0] = '\0';
-
-    // iterate over directory entries
-    struct dirent** namelist = NULL;
-    int n = scandir(path, &namelist, NULL, alphasort);
-    for (int i = 0; i < n; i++)
+    unsigned head = *io.cqhead;
+    while (head != __atomic_load_n(io.cqtail, __ATOMIC_ACQUIRE))
     {
-        // omit . from list
-        if (strcmp(namelist[i]->d_name, ".") == 0)
+        struct io_uring_cqe* cqe = &io.cqes[head & *io.cqmask];
+        client* c = (client*) (uintptr_t) cqe->user_data;
+        int bytes = cqe->res;
+        __atomic_store_n(io.cqhead, ++head, __ATOMIC_RELEASE);
+        c->reading = false;
+
+        // finish disconnecting client if connection was closed while file was read,
+        // or if file couldn't be read (or was truncated while being sent)
+        if (c->fd == -1 || bytes <= 0)
         {
+            disconnect(c);
             continue;
         }
 
-        // escape entry's name
-        char* name = htmlspecialchars(namelist[i]->d_name);
-        if (name == NULL)
-        {
-            free(list);
-            freedir(namelist, n);
-            printf("error 500 list() failed, approx line 624\n");
-            error(500);
-            return;
-        }
+        // send what was read as output
+        c->size = bytes;
+        c->offset = 0;
+        c->position += bytes;
+        c->remaining -= bytes;
 
-        // append list item to buffer
-        char* template = "<li><a href=\"%s\">%s</a></li>";
-        list = realloc(list, strlen(list) + strlen(template) - 2 + strlen(name) - 2 + strlen(name) + 1);
-        if (list == NULL)
-        {
-            free(name);
-            freedir(namelist, n);
-            printf("error 500 list failed, approx line 636\n");
-            error(500);
-            return;
-        }
-        if (sprintf(list + strlen(list), template, name, name) < 0)
+        // disconnect client if need be, whereupon work ignores any event for
+        // client that epoll reported alongside this worker's completions
+        if (!process(c))
         {
-            free(name);
-            freedir(namelist, n);
-            free(list);
-            printf("error 500 list failed, approx line 645\n");
-            error(500);
-            return;
+            disconnect(c);
         }
-
-        // free escaped name
-        free(name);
-    }
-
-    // free memory allocated by scandir
-    freedir(namelist, n);
-
-    // prepare response
-    const char* relative = path + strlen(root);
-    char* template = "<html><head><title>%s</title></head><body><h1>%s</h1><ul>%s</ul></body></html>";
-    char body[strlen(template) - 2 + strlen(relative) - 2 + strlen(relative) - 2 + strlen(list) + 1];
-    int length = sprintf(body, template, relative, relative, list);
-    if (length < 0)
-    {
-        free(list);
-        closedir(dir);
-        printf("error 500 list failed, approx line 666\n");
-        error(500);
-        return;
     }
-
-    // free buffer
-    free(list);
-
-    // close directory
-    closedir(dir);
-
-    // respond with list
-    char* headers = "Content-Type: text/html\r\n";
-    printf("from list\n");
-    respond(200, headers, body, length);
 }
 
 /**
- * Loads a file into memory dynamically allocated on heap.
- * Stores address thereof in *content and length thereof in *length.
+ * Checks whether files of MIME type type are worth compressing (i.e., are text).
+ * Returns true iff so.
  */
-bool load(FILE* file, BYTE** content, size_t* length)
+bool compressible(const char* type)
 {
-    // TODO
-    if(file == NULL)
+    static const char* texts[] =
     {
-        return false;
+        "application/javascript", "application/json", "application/manifest+json", "application/wasm",
+        "application/xml", "image/svg+xml", "image/x-icon"
+    };
+    if (strncmp(type, "text/", 5) == 0)
+    {
+        return strcmp(type, "text/x-php") != 0;
     }
-
-    // initialize content and its length
-    *content = "";
-    *length = 0;
-    
-    // BYTE buffer[BYTES];
-    char* buffer = malloc(BYTES * sizeof(char));
-    ssize_t bytesRead;
-    
-    do
+    for (int i = 0; i < sizeof(texts) / sizeof(texts[0]); i++)
     {
-        bytesRead = fread(buffer, sizeof(BYTE), BYTES, file);
-        printf("bytesRead = %zu\n", bytesRead);
-         // append bytes to content 
-        // *content = realloc(*content, bytesRead);
-        // *content = realloc(*content, *length + bytesRead + 1);
-        *content = malloc(sizeof(BYTE) * bytesRead);
-        if (*content == NULL)
+        if (strcmp(type, texts[i]) == 0)
         {
-            *length = 0;
-            break;
+            return true;
         }
-        // memcpy(*content, *buffer, bytesRead);
-        // memcpy(*content + *length, buffer, bytesRead);
-        *content = buffer;
-        *length += bytesRead;
-    }
-    while(bytesRead == BYTES);
-    
-    
-    // null-terminate content thus far
-    *(*content + *length) = '\0';
-    *content = buffer;
-    
-    printf("content(from load function) = [%s]\n", *content);
-    printf("length(from load function) = [%zu]\n", *length);
-
-    return true;
+    }
+    return false;
 }
 
 /**
- * Looks at path + file extension. Returns MIME type for supported extensions, else NULL.
+ * Responds to client with 304 if client's copy of a file (with entity-tag
+ * tag, modified at modified, of type type and size bytes) is current, else
+ * with 206 if client requested ranges thereof, else with 416 if those ranges
+ * are unsatisfiable, sending ranges from content, if not NULL, else from file
+ * (open as file, which is closed once sent), unless file is encoded per a
+ * content coding (i.e., coding isn't -1). Returns true iff responded,
+ * else false (in which case file is to be sent whole).
  */
-const char* lookup(const char* path)
+bool conditional(client* c, const char* tag, time_t modified, const char* type, off_t size, const BYTE* content, int file, int coding)
 {
-    printf("779 path fr lookup()= %s\n", path);
-    for (int i = 0; i < 50; i++)
+    char lines[BYTES];
+    int n = validators(lines, sizeof(lines), tag, modified, coding);
+
+    // vary (as would a 200) per Accept-Encoding if type is compressible, lest
+    // caches confuse encoded responses with these, which aren't
+    const char* vary = compressible(type) ? "Vary: Accept-Encoding\r\n" : "";
+    size_t vlength = strlen(vary);
+
+    // respond with 304 if client's copy is current
+    if (fresh(c, tag, modified))
     {
-        //find the dot
-        //changed from i + 1 to plain 'i'
-        if (path[i] == 46)
+        if (file != -1)
         {
-            int firstLetter = tolower(path[i + 1]);
-            int secondLetter = tolower(path[i + 2]);
-            if(firstLetter == 99) 
-            {
-                printf("790 firstLetter int fr lookup()= %i\n", firstLetter);
-                return "text/css";
-            }
-            else if(firstLetter == 104)
-            {
-                printf("795 lookup found text/html\n");
-                return "text/html";
-            }
-            else if(firstLetter == 106 && secondLetter == 115)
-            {
-                printf("800 lookup found text/javascript\n");
-                return "text/javascript";
-            }
-            else if(firstLetter == 112 && secondLetter == 104)
-            {
-                return "text/x-php";
-            }
-            else if(firstLetter == 103)
-            {
-                return "image/gif";
-            }
-            else if(firstLetter == 105)
-            {
-                return "image/x-icon";
-            }
-            else if(firstLetter == 106 && secondLetter == 112)
-            {
-                return "image/jpeg";
-            }
-            else if(firstLetter == 112 && secondLetter == 110)
-            {
-                return "image/png";
-            }
-            else 
-            {
-                return NULL;
-            }
+            close(file);
         }
+        struct iovec headers[] = {{(char*) vary, vlength}, {lines, n}};
+        respond(c, 304, headers, 2, NULL, 0);
+        return true;
     }
-    return 0;
-}
 
-/**
- * Parses a request-line, storing its absolute-path at abs_path 
- * and its query string at query, both of which are assumed
- * to be at least of length LimitRequestLine + 1.
- */
-bool parse(const char* line, char* abs_path, char* query)
-{
-    printf("840 parse() called\n");
-    if(line[0] != 'G' || line[1] != 'E' || line[2] != 'T' || line[3] != 32)
+    // respond with whole file unless client requested ranges thereof (and
+    // file isn't encoded, since ranges would be of its encoding)
+    int nranges = (coding == -1) ? bounds(c, size, tag, modified) : 0;
+    if (nranges == 0)
     {
-        printf("405 Method Not Allowed\n");
-        error(405);
         return false;
     }
-    
-    int charPosition = 4;
-    bool queryFound = false;
-    int q = 0;
-    int pathIndex = 0;
-    query[0] = '\0';
-     
-    do
+    char line[BYTES];
+    if (nranges == -1)
     {
-        // printf("860 check if target request contains a quotation mark\n");
-        // if target request contains a quotation mark
-        if(strchr(&line[charPosition], 34))
+        if (file != -1)
         {
-            printf("400 Bad Request");
-            error(400);
-            return 1;
+            close(file);
         }
-        // printf("868 check if query found\n");
-        if(queryFound)
+        struct iovec headers[] = {{(char*) vary, vlength}, {line, snprintf(line, sizeof(line), "Content-Range: bytes */%lld\r\n", (long long) size)}};
+        respond(c, 416, headers, 2, NULL, 0);
+        return true;
+    }
+
+    // respond with one range
+    if (nranges == 1)
+    {
+        range r = c->ranges[0];
+        size_t length = r.last - r.first + 1;
+        struct iovec headers[] =
+        {
+            {"Content-Type: ", 14}, {(char*) type, strlen(type)}, {"\r\n", 2}, {(char*) vary, vlength}, {lines, n},
+            {line, snprintf(line, sizeof(line), "Content-Range: bytes %lld-%lld/%lld\r\n", (long long) r.first, (long long) r.last, (long long) size)}
+        };
+        if (content != NULL)
         {
-            query[q++] = line[charPosition];
-            printf("867 query found %s\n", query);
+            respond(c, 206, headers, 6, content + r.first, length);
+            return true;
         }
-        //working on abs_path and looking for query
-        else 
+        respond(c, 206, headers, 6, NULL, length);
+        if (c->bodiless)
         {
-            // if question mark, start loading into query array
-            if(line[charPosition] == 63)
-            {
-                queryFound = true;
-            }
-            //start loading into abs_path array
-            else if(queryFound != true)
-            {
-                // printf("886 loaded [%c] into abs_path array\n", line[charPosition]);
-                abs_path[pathIndex++] = line[charPosition];
-            }
+            close(file);
+            return true;
         }
+        c->file = file;
+        c->position = r.first;
+        c->remaining = length;
+        return true;
     }
-    while(line[++charPosition] != 32);
-    // add null terminator to abs_path array
-    abs_path[pathIndex] = '\0';
-    printf("892 abs_path= [%s]\n", abs_path);
-    // add null terminator to query array
-    query[q] = '\0';
-    
-    // to skip over space
-    charPosition++;
-    // if target does not start with '/'
-    if(abs_path[0] != '/')
+
+    // respond with ranges as parts, each preceded by a boundary and headers, sizing body up front
+    c->nranges = nranges;
+    c->type = type;
+    c->total = size;
+    size_t length = delimiter(NULL, 0, c, nranges);
+    for (int i = 0; i < nranges; i++)
     {
-        printf("501 Not Implemented(parse error)");
-        error(501);
-        return 1;
+        length += delimiter(NULL, 0, c, i) + c->ranges[i].last - c->ranges[i].first + 1;
     }
-    
-    char version[9];
-    // if pathComplete, then we are now handling version 
-    for(int vi = 0; vi < 8; vi++)
+    static const char multipart[] = "Content-Type: multipart/byteranges; boundary=" BOUNDARY "\r\n";
+    struct iovec headers[] = {{(char*) multipart, sizeof(multipart) - 1}, {(char*) vary, vlength}, {lines, n}};
+    respond(c, 206, headers, 3, NULL, length);
+
+    // omit parts, if body is to be omitted
+    if (c->bodiless)
     {
-        version[vi] = line[charPosition + vi];
+        if (file != -1)
+        {
+            close(file);
+        }
+        c->nranges = 0;
+        return true;
     }
-    version[8] = '\0';
-    // check if version is indeed HTTP 1.1
-    char expectedVersion[] = "HTTP/1.1";
-    // printf("914 version = [%s], expectedVersion = [%s], line = %s", version, expectedVersion, line);
-    
-    for(int i = 0; i < 8; i++)
+
+    // queue parts from content, if any
+    if (content != NULL)
     {
-        // printf("912 version[i] = [%c]\n", version[i]);
-        if(version[i] != expectedVersion[i])
+        bool ok = true;
+        for (int i = 0; i <= nranges && ok; i++)
         {
+            ok = append(c, line, delimiter(line, sizeof(line), c, i)) &&
+                (i == nranges || append(c, content + c->ranges[i].first, c->ranges[i].last - c->ranges[i].first + 1));
+        }
+        c->nranges = 0;
 
-            printf("505 HTTP Version Not Supported(but parse did run)\n");
-            error(505);
-            return 1;
+        // response can't be completed
+        if (!ok)
+        {
+            c->closing = true;
         }
+        return true;
     }
-    //error(501);
-    //return false
-    printf("923 from parse: version = [%s], expectedVersion = [%s]\n", version, expectedVersion);
-    printf("924 parse ran: abs_path = [%s]\n", abs_path);
-    return true;
-}
 
-/**
- * Returns status code's reason phrase.
- *
- * http://www.w3.org/Protocols/rfc2616/rfc2616-sec6.html#sec6
- * https://tools.ietf.org/html/rfc2324
- */
-const char* reason(unsigned short code)
-{
-    switch (code)
+    // else send first part's headers, leaving its range and rest of parts to flush
+    if (!append(c, line, delimiter(line, sizeof(line), c, 0)))
     {
-        case 200: return "OK";
-        case 301: return "Moved Permanently";
-        case 400: return "Bad Request";
-        case 403: return "Forbidden";
-        case 404: return "Not Found";
-        case 405: return "Method Not Allowed";
-        case 414: return "Request-URI Too Long";
-        case 418: return "I'm a teapot";
-        case 500: return "Internal Server Error";
-        case 501: return "Not Implemented";
-        case 505: return "HTTP Version Not Supported";
-        default: return NULL;
+        c->closing = true;
     }
+    c->file = file;
+    c->position = c->ranges[0].first;
+    c->remaining = c->ranges[0].last - c->ranges[0].first + 1;
+    c->part = 1;
+    return true;
 }
 
 /**
- * Redirects client to uri.
+ * Checks (without blocking) whether a client has connected to server.
+ * If so, registers client's socket with epoll and returns true.
  */
-void redirect(const char* uri)
+bool connected(void)
 {
-    char* template = "Location: %s\r\n";
-    char headers[strlen(template) - 2 + strlen(uri) + 1];
-    if (sprintf(headers, template, uri) < 0)
+    uint64_t began = tick();
+    struct sockaddr_in cli_addr;
+    memset(&cli_addr, 0, sizeof(cli_addr));
+    socklen_t cli_len = sizeof(cli_addr);
+    int fd = accept4(sfd, (struct sockaddr*) &cli_addr, &cli_len, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    if (fd == -1)
     {
-        printf("error 500 redirect failed, approx line 883\n");
-        error(500);
-        return;
+        return false;
     }
-    respond(301, headers, NULL, 0);
-}
 
-/**
- * Reads (without blocking) an HTTP request's headers into memory dynamically allocated on heap.
- * Stores address thereof in *message and length thereof in *length.
- */
-bool request(char** message, size_t* length)
-{
-    // ensure socket is open
-    if (cfd == -1)
+    // reuse a closed connection's state, if any
+    client* c = clients;
+    if (c != NULL)
     {
-        return false;
+        clients = c->next;
     }
-
-    // initialize message and its length
-    *message = NULL;
-    *length = 0;
-
-    // read message 
-    while (*length < LimitRequestLine + LimitRequestFields * LimitRequestFieldSize + 4)
+    else
     {
-        // read from socket
-        BYTE buffer[BYTES];
-        ssize_t bytes = read(cfd, buffer, BYTES);
-        if (bytes < 0)
+        c = malloc(sizeof(client));
+        if (c == NULL)
         {
-            if (*message != NULL)
-            {
-                free(*message);
-                *message = NULL;
-            }
-            *length = 0;
-            break;
+            close(fd);
+            return true;
         }
+        c->output = NULL;
+        c->capacity = 0;
+        c->records = NULL;
+        c->rcapacity = 0;
+        c->script = NULL;
+        c->scapacity = 0;
+        c->arena = NULL;
+        c->allocated = 0;
 
-        // append bytes to message 
-        *message = realloc(*message, *length + bytes + 1);
-        if (*message == NULL)
+        // path's buffer starts with root, followed by room for longest absolute-path and index.html
+        c->path = malloc(rootlength + LimitRequestLine + 10 + 1);
+        if (c->path == NULL)
         {
-            *length = 0;
-            break;
+            free(c);
+            close(fd);
+            return true;
         }
-        memcpy(*message + *length, buffer, bytes);
-        *length += bytes;
+        memcpy(c->path, root, rootlength);
+    }
+    c->fd = fd;
+    c->message = NULL;
+    c->length = 0;
+    c->scanned = 0;
+    c->nlines = 0;
+    c->end = 0;
+    c->size = 0;
+    c->offset = 0;
+    c->entry = NULL;
+    c->file = -1;
+    c->reading = false;
+    c->nranges = 0;
+    c->cgi = -1;
+    c->bodiless = false;
+    c->closing = false;
+    c->disconnected = false;
+    c->heading = false;
+    c->note.status = 0;
+    c->next = NULL;
+    count(&self->ledger->opened, 1);
 
-        // null-terminate message thus far
-        *(*message + *length) = '\0';
+    // add client to worker's connections, giving it KEEPALIVE seconds to send a request
+    c->newer = NULL;
+    c->older = connections;
+    if (connections != NULL)
+    {
+        connections->newer = c;
+    }
+    connections = c;
+    await(c);
 
-        // search for CRLF CRLF
-        int offset = (*length - bytes < 3) ? *length - bytes : 3;
-        char* haystack = *message + *length - bytes - offset;
-        char* needle = strstr(haystack, "\r\n\r\n");
-        if (needle != NULL)
-        {
-            // trim to one CRLF and null-terminate
-            *length = needle - *message + 2;
-            *message = realloc(*message, *length + 1);
-            if (*message == NULL)
-            {
-                break;
-            }
-            *(*message + *length) = '\0';
-
-            // ensure request-line is no longer than LimitRequestLine
-            haystack = *message;
-            needle = strstr(haystack, "\r\n");
-            if (needle == NULL || (needle - haystack + 2) > LimitRequestLine)
-            {
-                break;
-            }
+    // watch for socket becoming readable or writable (edge-triggered)
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = c;
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event) == -1)
+    {
+        disconnect(c);
+    }
+    observe(STAGE_CONNECT, began);
+    return true;
+}
 
-            // count fields in message
-            int fields = 0;
-            haystack = needle + 2;
-            while (*haystack != '\0')
-            {
-                // look for CRLF
-                needle = strstr(haystack, "\r\n");
-                if (needle == NULL)
-                {
-                    break;
-                }
+/**
+ * Adds n to counter, one of this worker's statistics, which only it updates,
+ * storing the sum atomically so that any worker can read counter without a lock.
+ */
+void count(size_t* counter, size_t n)
+{
+    __atomic_store_n(counter, *counter + n, __ATOMIC_RELAXED);
+}
 
-                // ensure field is no longer than LimitRequestFieldSize
-                if (needle - haystack + 2 > LimitRequestFieldSize)
-                {
-                    break;
-                }
+/**
+ * Returns a Date header (with CRLF) for the current second, formatting one
+ * at most once per second per worker.
+ */
+view date(void)
+{
+    // coarse clock is read without a system call
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    if (ts.tv_sec != dated || datelength == 0)
+    {
+        struct tm tm;
+        gmtime_r(&ts.tv_sec, &tm);
+        datelength = strftime(dateline, sizeof(dateline), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm);
+        dated = ts.tv_sec;
+    }
+    view v = {dateline, datelength};
+    return v;
+}
 
-                // look beyond CRLF
-                haystack = needle + 2;
-            }
+/**
+ * Formats into s (of size bytes), as snprintf would, boundary and headers
+ * that precede client's ith range in a multipart/byteranges response, or,
+ * if i is number of ranges, final boundary. Returns number of bytes formatted
+ * (or that would have been, if s is NULL).
+ */
+int delimiter(char* s, size_t size, const client* c, int i)
+{
+    if (i == c->nranges)
+    {
+        return snprintf(s, size, "\r\n--" BOUNDARY "--\r\n");
+    }
+    return snprintf(s, size, "\r\n--" BOUNDARY "\r\nContent-Type: %s\r\nContent-Range: bytes %lld-%lld/%lld\r\n\r\n",
+        c->type, (long long) c->ranges[i].first, (long long) c->ranges[i].last, (long long) c->total);
+}
 
-            // if we didn't get to end of message, we must have erred
-            if (*haystack != '\0')
-            {
-                break;
-            }
+/**
+ * Responds to client with cached entry, writing as much as socket will take
+ * with one call to sendmsg and leaving the rest to be sent by flush.
+ */
+void deliver(client* c, entry* e)
+{
+    // respond to conditional or range request, if any, for a file
+    if (e->tag[0] != '\0' && conditional(c, e->tag, e->modified, e->type, e->length - e->offset, e->response + e->offset, -1, e->coding))
+    {
+        return;
+    }
 
-            // ensure message has no more than LimitRequestFields
-            if (fields > LimitRequestFields)
-            {
-                break;
-            }
+    // gather Status-Line, Date, Connection header (if closing), and entry's headers and content
+    uint64_t began = tick();
+    view d = date();
+    struct iovec iov[4];
+    int n = 0;
+    iov[n].iov_base = (char*) statuses[200].s;
+    iov[n++].iov_len = statuses[200].length;
+    iov[n].iov_base = (char*) d.s;
+    iov[n++].iov_len = d.length;
+    if (c->closing)
+    {
+        iov[n].iov_base = "Connection: close\r\n";
+        iov[n++].iov_len = 19;
+    }
+    iov[n].iov_base = e->response;
+    iov[n++].iov_len = (c->bodiless) ? e->offset : e->length;
 
-            // valid
-            return true;
+    // write as much as socket will take, queueing what remains of Status-Line and
+    // headers, then keep entry until flush has sent the rest, unless body is omitted
+    if (c->bodiless)
+    {
+        queue(c, iov, n, emit(c, iov, n, false));
+    }
+    else
+    {
+        size_t written = queue(c, iov, n - 1, emit(c, iov, n, false));
+        if (written < e->length)
+        {
+            e->refs++;
+            c->entry = e;
+            c->sent = written;
         }
     }
 
-    // invalid
-    if (*message != NULL)
+    // note access
+    observe(STAGE_RESPOND, began);
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++)
     {
-        free(*message);
+        bytes += iov[i].iov_len;
     }
-    *message = NULL;
-    *length = 0;
-    return false;
+    account(c, 200, bytes);
 }
 
 /**
- * Responds to a client with status code, headers, and body of specified length.
+ * Formats into s (of size bytes) Content-Type and, if file is encoded per
+ * content coding coding (i.e., coding isn't -1), Content-Encoding headers,
+ * along with Vary (if type is compressible) and validators' headers, for a
+ * file with entity-tag tag, modified at modified. Returns number of bytes formatted.
  */
-void respond(int code, const char* headers, const char* body, size_t length)
+int describe(char* s, size_t size, const char* type, int coding, const char* tag, time_t modified)
 {
-    // determine Status-Line's phrase
-    // http://www.w3.org/Protocols/rfc2616/rfc2616-sec6.html#sec6.1
-    const char* phrase = reason(code);
-    if (phrase == NULL)
+    int n = snprintf(s, size, "Content-Type: %s\r\n%s%s%s%s", type, (coding != -1) ? "Content-Encoding: " : "",
+        (coding != -1) ? codings[coding].token : "", (coding != -1) ? "\r\n" : "",
+        compressible(type) ? "Vary: Accept-Encoding\r\n" : "");
+    if (n < 0 || n >= size)
     {
-        return;
+        return 0;
     }
+    return n + validators(s + n, size - n, tag, modified, coding);
+}
 
-    // respond with Status-Line
-    if (dprintf(cfd, "HTTP/1.1 %i %s\r\n", code, phrase) < 0)
+/**
+ * Connects (without blocking) to FastCGI server. Returns socket, else -1.
+ */
+int dial(void)
+{
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1)
     {
-        return;
+        return -1;
+    }
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    strncpy(addr.sun_path, fastcgi, sizeof(addr.sun_path) - 1);
+    if (connect(fd, (struct sockaddr*) &addr, sizeof(addr)) == -1 && errno != EINPROGRESS)
+    {
+        // preserve connect's errno, which distinguishes a busy server from a missing one
+        int errsv = errno;
+        close(fd);
+        errno = errsv;
+        return -1;
     }
+    return fd;
+}
 
-    // respond with headers
-    if (dprintf(cfd, "%s", headers) < 0)
+/**
+ * Closes client's connection, keeping its state for reuse by another client.
+ */
+void disconnect(client* c)
+{
+    // disconnect client but once
+    if (c->disconnected)
     {
         return;
     }
 
-    // respond with CRLF
-    if (dprintf(cfd, "\r\n") < 0)
+    // closing socket also removes it from epoll
+    if (c->fd != -1)
     {
-        return;
+        close(c->fd);
+        c->fd = -1;
+        c->deadline = 0;
+        count(&self->ledger->closed, 1);
     }
 
-    // respond with body
-    if (write(cfd, body, length) == -1)
+    // leave the rest until file's read into output completes, lest output be reused meanwhile
+    if (c->reading)
     {
         return;
     }
 
-    // log response line
-    if (code == 200)
+    // log access, if response was cut short
+    post(c);
+
+    // return message's buffer to pool, and arena to spares
+    relinquish(c);
+    reset(c, false);
+
+    // stop sending cached response, if any
+    if (c->entry != NULL)
+    {
+        release(c->entry);
+        c->entry = NULL;
+    }
+
+    // close file being sent, if any
+    if (c->file != -1)
+    {
+        close(c->file);
+        c->file = -1;
+    }
+
+    // abandon script being interpreted, if any
+    if (c->cgi != -1)
     {
-        // green
-        printf("\033[32m");
+        hangup(c, false);
+    }
+
+    // remove client from worker's connections
+    if (c->newer != NULL)
+    {
+        c->newer->older = c->older;
     }
     else
     {
-        // red
-        printf("\033[33m");
+        connections = c->older;
+    }
+    if (c->older != NULL)
+    {
+        c->older->newer = c->newer;
     }
-    printf("HTTP/1.1 %i %s", code, phrase);
-    printf("\033[39m\n");
-}
 
+    // keep output's buffer for next client, once epoll's latest events have been handled
+    c->size = 0;
+    c->offset = 0;
+    c->disconnected = true;
+    c->next = departed;
+    departed = c;
+}
 
 /**
- * Starts server on specified port rooted at path.
+ * Formats into batch (of BATCH bytes) and writes to stdout the notes in
+ * journal j, then reports any that were dropped.
  */
-void start(short port, const char* path)
+void drain(journal* j, char* batch)
 {
-    // path to server's root
-     root = realpath(path, NULL);
-    // root = "../server.c";
+    // format each note as a line, writing lines whenever batch fills
+    static char stamp[32];
+    static time_t stamped = -1;
+    size_t head = j->head, tail = __atomic_load_n(&j->tail, __ATOMIC_ACQUIRE), length = 0;
+    for (; head != tail; head++)
+    {
+        const note* n = &j->notes[head % JOURNAL];
+        if (n->time != stamped)
+        {
+            struct tm tm;
+            strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", gmtime_r(&n->time, &tm));
+            stamped = n->time;
+        }
+        if (BATCH - length < NOTE + 128)
+        {
+            ssize_t written = write(STDOUT_FILENO, batch, length);
+            (void) written;
+            length = 0;
+        }
+        if (n->status != 0)
+        {
+            length += sprintf(batch + length, "%s \"%s\" %u %zu %uus\n", stamp, n->text, n->status, n->bytes, n->duration);
+        }
+        else
+        {
+            length += sprintf(batch + length, "%s %s: %s\n", stamp, levels[n->level], n->text);
+        }
+    }
 
-    printf("1154 root = [%s]\n", root);
-    if (root == NULL)
+    // free notes' slots for worker
+    __atomic_store_n(&j->head, head, __ATOMIC_RELEASE);
+
+    // report notes dropped, if any
+    size_t dropped = __atomic_exchange_n(&j->dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0)
     {
-        stop();
+        length += sprintf(batch + length, "%s %s: %zu notes dropped\n", stamp, levels[LOG_WARNING], dropped);
     }
+    if (length > 0)
+    {
+        ssize_t written = write(STDOUT_FILENO, batch, length);
+        (void) written;
+    }
+}
 
-    // ensure root is executable
-    if (access(root, X_OK) == -1)
+/**
+ * Writes iov's n buffers to client's socket with one call to sendmsg, telling
+ * kernel if more is to follow, unless output is already queued (lest
+ * responses be reordered). Returns number of bytes written.
+ */
+size_t emit(client* c, const struct iovec* iov, int n, bool more)
+{
+    if (c->size > 0)
     {
-        stop();
+        return 0;
+    }
+    struct msghdr msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec*) iov;
+    msg.msg_iovlen = n;
+    ssize_t bytes;
+    do
+    {
+        bytes = sendmsg(c->fd, &msg, MSG_NOSIGNAL | (more ? MSG_MORE : 0));
     }
+    while (bytes == -1 && errno == EINTR);
 
-    // announce root
-    printf("\033[33m");
-    printf("1167 Using %s for server's root", root);
-    printf("\033[39m\n");
+    // if socket's buffer is full (or connection has failed), flush will find out
+    return (bytes == -1) ? 0 : bytes;
+}
 
-    // create a socket
-    sfd = socket(AF_INET, SOCK_STREAM, 0);
-    if (sfd == -1)
+/**
+ * Compresses cached file (or listing) e per most preferred content coding
+ * among accepts (a bitmask) that server can compress with on the fly,
+ * caching result as a variant. Returns variant's entry, else NULL.
+ */
+entry* encode(entry* e, int accepts)
+{
+    int coding = -1;
+    for (int i = 0; i < CODINGS && coding == -1; i++)
     {
-        stop();
+        if ((accepts & (1 << i)) && codings[i].dynamic)
+        {
+            coding = i;
+        }
+    }
+    size_t length = e->length - e->offset;
+    char key[PATH_MAX + 8];
+    if (coding == -1 || length < SMALLEST || !variant(key, sizeof(key), e->path, coding))
+    {
+        return NULL;
+    }
+
+    // keep e while compressing it, lest caching variant evict it
+    e->refs++;
+    entry* v = NULL;
+    size_t n;
+    BYTE* compressed = squeeze(coding, e->response + e->offset, length, &n);
+    if (compressed != NULL)
+    {
+        // derive variant's entity-tag from file's, if any
+        char tag[TAG] = "";
+        if (e->tag[0] != '\0')
+        {
+            snprintf(tag, sizeof(tag), "%.*s-%s\"", (int) strlen(e->tag) - 1, e->tag, codings[coding].token);
+        }
+
+        // render headers and prepend them to compressed content
+        char headers[BYTES];
+        int h = describe(headers, sizeof(headers), e->type, coding, tag, e->modified);
+        h += snprintf(headers + h, sizeof(headers) - h, "Content-Length: %zu\r\n\r\n", n);
+        BYTE* response = (h < sizeof(headers)) ? malloc(h + n) : NULL;
+        if (response != NULL)
+        {
+            memcpy(response, headers, h);
+            memcpy(response + h, compressed, n);
+            v = admit(key, e->type, response, h + n);
+            if (v != NULL)
+            {
+                v->coding = coding;
+                v->offset = h;
+                strcpy(v->tag, tag);
+                v->modified = e->modified;
+            }
+        }
+        free(compressed);
     }
+    release(e);
+    return v;
+}
 
-    // allow reuse of address (to avoid "Address already in use")
-    int optval = 1;
-    setsockopt(sfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+/**
+ * Responds to client with specified status code, using response rendered by start.
+ */
+void error(client* c, unsigned short code)
+{
+    // ensure code is an error with a reason-phrase
+    if (code >= 600 || errors[code].s == NULL)
+    {
+        return;
+    }
 
-    // assign name to socket
-    struct sockaddr_in serv_addr;
-    memset(&serv_addr, 0, sizeof(serv_addr));
-    serv_addr.sin_family = AF_INET;
-    serv_addr.sin_port = htons(port);
-    serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    if (bind(sfd, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) == -1)
+    // gather Status-Line, Date, Connection header (if closing), and rendered response
+    uint64_t began = tick();
+    view d = date();
+    struct iovec iov[4];
+    int n = 0;
+    iov[n].iov_base = (char*) statuses[code].s;
+    iov[n++].iov_len = statuses[code].length;
+    iov[n].iov_base = (char*) d.s;
+    iov[n++].iov_len = d.length;
+    if (c->closing)
     {
-        printf("\033[33m");
-        printf("Port %i already in use", port);
-        printf("\033[39m\n");
-        stop();
+        iov[n].iov_base = "Connection: close\r\n";
+        iov[n++].iov_len = 19;
     }
+    iov[n].iov_base = (char*) errors[code].s;
+    iov[n++].iov_len = errors[code].length;
 
-    // listen for connections
-    if (listen(sfd, SOMAXCONN) == -1)
+    // omit content (after headers' blank line), if body is to be omitted
+    if (c->bodiless)
     {
-        stop();
+        iov[n - 1].iov_len = (char*) memmem(errors[code].s, errors[code].length, "\r\n\r\n", 4) + 4 - errors[code].s;
     }
 
-    // announce port in use
-    struct sockaddr_in addr;
-    socklen_t addrlen = sizeof(addr);
-    if (getsockname(sfd, (struct sockaddr*) &addr, &addrlen) == -1)
+    // respond with error, queueing whatever socket doesn't take
+    queue(c, iov, n, emit(c, iov, n, false));
+
+    // note access
+    observe(STAGE_RESPOND, began);
+    size_t bytes = 0;
+    for (int i = 0; i < n; i++)
     {
-        stop();
+        bytes += iov[i].iov_len;
     }
-    printf("\033[33m");
-    printf("1212 Listening on port %i", ntohs(addr.sin_port));
-    printf("\033[39m\n");
+    account(c, code, bytes);
 }
 
 /**
- * Stop server, deallocating any resources.
+ * Stores in tag (of TAG bytes) an entity-tag for file described by sb, derived
+ * from its inode, size, and modification time, and from index of content
+ * coding with which it's encoded (-1 if none).
  */
-void stop(void)
+void etag(char* tag, const struct stat* sb, int coding)
 {
-    // preserve errno across this function's library calls
-    int errsv = errno;
-
-    // announce stop
-    printf("\033[33m");
-    printf("Stopping server\n");
-    printf("\033[39m");
+    snprintf(tag, TAG, "\"%llx-%llx-%llx%s%s\"", (unsigned long long) sb->st_ino, (unsigned long long) sb->st_size,
+        (unsigned long long) sb->st_mtime, (coding != -1) ? "-" : "", (coding != -1) ? codings[coding].token : "");
+}
 
-    // free root, which was allocated by realpath
-    if (root != NULL)
+/**
+ * Removes entry from cache, freeing it unless clients are still sending it.
+ */
+void evict(entry* e)
+{
+    // remove from hash table
+    entry** p = &buckets[e->hash & (nbuckets - 1)];
+    while (*p != e)
     {
-        free(root);
+        p = &(*p)->next;
     }
+    *p = e->next;
+    nentries--;
 
-    // close server socket
-    if (sfd != -1)
+    // remove from list
+    if (e->newer != NULL)
+    {
+        e->newer->older = e->older;
+    }
+    else
+    {
+        newest = e->older;
+    }
+    if (e->older != NULL)
+    {
+        e->older->newer = e->newer;
+    }
+    else
     {
-        close(sfd);
+        oldest = e->newer;
     }
+    cachesize -= e->length;
 
-    // stop server
-    exit(errsv);
+    // free unless still in use
+    e->evicted = true;
+    e->refs++;
+    release(e);
 }
 
 /**
- * Transfers file at path with specified type to client.
+ * Responds to client with metrics, in Prometheus's text format, totaling
+ * every worker's statistics, each read (without a lock) while being updated.
  */
-void transfer(const char* path, const char* type)
+void expose(client* c)
 {
-    // ensure path is readable
-    if (access(path, R_OK) == -1)
+    // total workers' statistics
+    ledger total;
+    memset(&total, 0, sizeof(total));
+    for (int i = 0; i < nworkers; i++)
     {
-        error(403);
-        return;
+        ledger* l = workers[i].ledger;
+        for (int code = 0; code < 600; code++)
+        {
+            total.statuses[code] += __atomic_load_n(&l->statuses[code], __ATOMIC_RELAXED);
+        }
+        total.bytes += __atomic_load_n(&l->bytes, __ATOMIC_RELAXED);
+        total.opened += __atomic_load_n(&l->opened, __ATOMIC_RELAXED);
+        total.closed += __atomic_load_n(&l->closed, __ATOMIC_RELAXED);
+        total.hits += __atomic_load_n(&l->hits, __ATOMIC_RELAXED);
+        total.misses += __atomic_load_n(&l->misses, __ATOMIC_RELAXED);
+        total.recalls += __atomic_load_n(&l->recalls, __ATOMIC_RELAXED);
+        total.lapses += __atomic_load_n(&l->lapses, __ATOMIC_RELAXED);
+        for (int s = 0; s < STAGES; s++)
+        {
+            for (int b = 0; b < BINS; b++)
+            {
+                total.latencies[s][b] += __atomic_load_n(&l->latencies[s][b], __ATOMIC_RELAXED);
+            }
+            total.nanoseconds[s] += __atomic_load_n(&l->nanoseconds[s], __ATOMIC_RELAXED);
+        }
     }
 
-    // open file
-    FILE* file = fopen(path, "r");
-    if (file == NULL)
+    // render responses by status code (omitting those never sent)
+    BYTE* body = NULL;
+    size_t size = 0, capacity = 0;
+    char line[1024];
+    bool ok = extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+        "# HELP http_responses_total Responses sent, by status code.\n"
+        "# TYPE http_responses_total counter\n"));
+    for (int code = 0; code < 600 && ok; code++)
     {
-        printf("error 500 transfer failed, approx line 1171\n");
-        error(500);
-        return;
+        if (total.statuses[code] != 0)
+        {
+            ok = extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+                "http_responses_total{code=\"%i\"} %zu\n", code, total.statuses[code]));
+        }
     }
 
-    // load file's content
-    BYTE* content;
-    size_t length;
-    printf("load (in transfer function approx line 1201) called\n");
-    if (load(file, &content, &length) == false)
+    // render bytes sent, connections (of which more may seem closed than opened,
+    // if closed while being totaled), and caches' hits and misses
+    ok = ok && extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+        "# HELP http_response_bytes_total Bytes of responses sent.\n"
+        "# TYPE http_response_bytes_total counter\n"
+        "http_response_bytes_total %zu\n"
+        "# HELP http_connections_total Connections accepted.\n"
+        "# TYPE http_connections_total counter\n"
+        "http_connections_total %zu\n"
+        "# HELP http_connections_active Connections open.\n"
+        "# TYPE http_connections_active gauge\n"
+        "http_connections_active %zu\n"
+        "# HELP http_cache_hits_total Lookups that found what was sought in cache of files or of paths' metadata.\n"
+        "# TYPE http_cache_hits_total counter\n"
+        "http_cache_hits_total{cache=\"files\"} %zu\n"
+        "http_cache_hits_total{cache=\"metadata\"} %zu\n"
+        "# HELP http_cache_misses_total Lookups that didn't find what was sought in cache of files or of paths' metadata.\n"
+        "# TYPE http_cache_misses_total counter\n"
+        "http_cache_misses_total{cache=\"files\"} %zu\n"
+        "http_cache_misses_total{cache=\"metadata\"} %zu\n",
+        total.bytes, total.opened, (total.opened > total.closed) ? total.opened - total.closed : 0,
+        total.hits, total.recalls, total.misses, total.lapses));
+
+    // render each stage's histogram, whose buckets are cumulative
+    ok = ok && extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+        "# HELP http_stage_duration_seconds Latencies of stages of serving requests.\n"
+        "# TYPE http_stage_duration_seconds histogram\n"));
+    for (int s = 0; s < STAGES && ok; s++)
+    {
+        size_t cumulative = 0;
+        for (int b = 0; b < BINS && ok; b++)
+        {
+            cumulative += total.latencies[s][b];
+            if (b < BINS - 1)
+            {
+                ok = extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+                    "http_stage_duration_seconds_bucket{stage=\"%s\",le=\"%.9g\"} %zu\n",
+                    stages[s], (double) (1ULL << (SHIFT + b)) / 1e9, cumulative));
+            }
+            else
+            {
+                ok = extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+                    "http_stage_duration_seconds_bucket{stage=\"%s\",le=\"+Inf\"} %zu\n", stages[s], cumulative));
+            }
+        }
+        ok = ok && extend(&body, &size, &capacity, line, snprintf(line, sizeof(line),
+            "http_stage_duration_seconds_sum{stage=\"%s\"} %.9f\n"
+            "http_stage_duration_seconds_count{stage=\"%s\"} %zu\n",
+            stages[s], total.nanoseconds[s] / 1e9, stages[s], cumulative));
+    }
+    if (!ok)
     {
-        printf("error 500 transfer (which calls load) failed, approx line 1181\n");
-        error(500);
+        free(body);
+        error(c, 500);
         return;
     }
 
-    // close file
-    fclose(file);
+    // respond with metrics, which are never to be cached
+    static const char type[] = "Content-Type: text/plain; version=0.0.4\r\nCache-Control: no-store\r\n";
+    struct iovec headers[] = {{(char*) type, sizeof(type) - 1}};
+    respond(c, 200, headers, 1, body, size);
+    free(body);
+}
 
-    // prepare response
-    char* template = "Content-Type: %s\r\n";
-    printf("(printed from transfer function approx 1248)\n");
-    char headers[strlen(template) - 2 + strlen(type) + 1];
-    if (sprintf(headers, template, type) < 0)
+/**
+ * Appends length bytes to buffer, of which size bytes are in use, doubling
+ * its capacity as needed. Returns true iff successful.
+ */
+bool extend(BYTE** buffer, size_t* size, size_t* capacity, const void* bytes, size_t length)
+{
+    if (length == 0)
     {
-        printf("error 500 transfer failed, approx line 1194\n");
-        error(500);
-        return;
+        return true;
     }
-    
-    // respond with file's content
-    respond(200, headers, content, length);
-
-    // free file's content
-    free(content);
+    if (!reserve(buffer, capacity, *size + length))
+    {
+        return false;
+    }
+    memcpy(*buffer + *size, bytes, length);
+    *size += length;
+    return true;
 }
 
 /**
- * URL-decodes string, returning dynamically allocated memory for decoded string
- * that must be deallocated by caller.
+ * Looks up cache's entry for path, whose hash is as specified, marking it
+ * most recently used. Returns entry if found, else NULL.
  */
-char* urldecode(const char* s)
+entry* find(const char* path, size_t hash)
 {
-    // check whether s is NULL
-    if (s == NULL)
+    if (nbuckets == 0)
     {
         return NULL;
     }
+    for (entry* e = buckets[hash & (nbuckets - 1)]; e != NULL; e = e->next)
+    {
+        if (e->hash == hash && strcmp(e->path, path) == 0)
+        {
+            // move to front of list
+            if (e != newest)
+            {
+                e->newer->older = e->older;
+                if (e->older != NULL)
+                {
+                    e->older->newer = e->newer;
+                }
+                else
+                {
+                    oldest = e->newer;
+                }
+                e->newer = NULL;
+                e->older = newest;
+                newest->newer = e;
+                newest = e;
+            }
+            return e;
+        }
+    }
+    return NULL;
+}
 
-    // allocate enough (zeroed) memory for an undecoded copy of s
-    char* t = calloc(strlen(s) + 1, 1);
-    if (t == NULL)
+/**
+ * Writes (without blocking) as much of client's output, followed by as much
+ * of the cached response or file being sent, if any, as its socket will accept.
+ * Returns false iff connection has failed.
+ */
+bool flush(client* c)
+{
+    while (c->offset < c->size)
     {
-        return NULL;
+        // tell kernel that more is coming if a file follows, so that headers and file can share packets
+        int flags = MSG_NOSIGNAL | ((c->file != -1 && c->remaining > 0) ? MSG_MORE : 0);
+        ssize_t bytes = send(c->fd, c->output + c->offset, c->size - c->offset, flags);
+        if (bytes == -1)
+        {
+            // socket's buffer is full, so wait for epoll to report it writable
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return true;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+        c->offset += bytes;
     }
-    
-    // iterate over characters in s, decoding percent-encoded octets, per
-    // https://www.ietf.org/rfc/rfc3986.txt
-    for (int i = 0, j = 0, n = strlen(s); i < n; i++, j++)
+
+    // all written, so start output over
+    c->size = 0;
+    c->offset = 0;
+
+    // send rest of cached response
+    while (c->entry != NULL)
     {
-        if (s[i] == '%' && i < n - 2)
+        ssize_t bytes = send(c->fd, c->entry->response + c->sent, c->entry->length - c->sent, MSG_NOSIGNAL);
+        if (bytes == -1)
         {
-            char octet[3];
-            octet[0] = s[i + 1];
-            octet[1] = s[i + 2];
-            octet[2] = '\0';
-            t[j] = (char) strtol(octet, NULL, 16);
-            i += 2;
+            // socket's buffer is full, so wait for epoll to report it writable
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return true;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
         }
-        else if (s[i] == '+')
+        c->sent += bytes;
+        if (c->sent == c->entry->length)
         {
-            t[j] = ' ';
+            release(c->entry);
+            c->entry = NULL;
         }
-        else
+    }
+
+    // read file's next chunk into output with io_uring, if any, lest a read
+    // from disk block worker, leaving it to be sent once read
+    if (c->file != -1 && c->remaining > 0 && io.fd != -1)
+    {
+        return c->reading || submit(c);
+    }
+
+    // send file straight from page cache to socket, resuming wherever last call left off
+    while (c->file != -1 && c->remaining > 0)
+    {
+        ssize_t bytes = sendfile(c->fd, c->file, &c->position, c->remaining);
+        if (bytes == -1)
+        {
+            // socket's buffer is full, so wait for epoll to report it writable
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return true;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            return false;
+        }
+
+        // file was truncated while being sent, so response can't be completed
+        if (bytes == 0)
+        {
+            return false;
+        }
+        c->remaining -= bytes;
+    }
+
+    // follow range with next part's headers and range, if any, or with final boundary
+    if (c->file != -1 && c->nranges > 0 && c->part <= c->nranges)
+    {
+        char lines[BYTES];
+        if (!append(c, lines, delimiter(lines, sizeof(lines), c, c->part)))
+        {
+            return false;
+        }
+        if (c->part < c->nranges)
         {
-            t[j] = s[i];
+            c->position = c->ranges[c->part].first;
+            c->remaining = c->ranges[c->part].last - c->ranges[c->part].first + 1;
         }
+        c->part++;
+        return flush(c);
     }
 
-    // escaped string
-    return t;
+    // all sent, so close file
+    if (c->file != -1)
+    {
+        close(c->file);
+        c->file = -1;
+        c->nranges = 0;
+    }
+    return true;
 }
 
+/**
+ * Forgets what's known of path (of specified length) and of path with a
+ * trailing slash, if anything.
+ */
+void forget(const char* path, size_t length)
+{
+    if (metas == NULL)
+    {
+        return;
+    }
+    for (int i = 0; i < 2; i++)
+    {
+        size_t n = length + i;
+        size_t h = hash(path, length);
+        if (i == 1)
+        {
+            // extend hash with a slash
+            h ^= '/';
+            h *= 1099511628211ULL;
+        }
+        meta* m = &metas[h & (METAS - 1)];
+        if (m->path != NULL && m->hash == h && m->length == n && memcmp(m->path, path, length) == 0 &&
+            (i == 0 || m->path[length] == '/'))
+        {
+            if (!m->exists)
+            {
+                nnegatives--;
+            }
+            free(m->path);
+            m->path = NULL;
+        }
+    }
+}
+
+/**
+ * Forwards bytes of script's output to client, parsing its CGI headers a
+ * line at a time as they arrive, then responding with them (less Status,
+ * whose code becomes response's, and any that frame a response), then
+ * relaying its body in chunks (unless client can't accept chunks, in which
+ * case body is delimited by closing connection). Returns false iff headers
+ * are invalid or too long.
+ */
+bool forward(client* c, const BYTE* bytes, size_t length)
+{
+    // an empty record isn't the end of the body, lest it be a last chunk
+    if (length == 0)
+    {
+        return true;
+    }
+
+    // relay body, which responses to 204, 304, and HEAD lack
+    if (c->started)
+    {
+        if (c->status == 204 || c->status == 304 || c->bodiless)
+        {
+            return true;
+        }
+        c->note.bytes += length;
+        count(&self->ledger->bytes, length);
+        return (c->chunked) ? chunk(c, bytes, length) : append(c, bytes, length);
+    }
+
+    const BYTE* end = bytes + length;
+    bool ended = false;
+    while (bytes < end && !ended)
+    {
+        // gather line (up to LF) until complete
+        const BYTE* lf = memchr(bytes, '\n', end - bytes);
+        size_t n = ((lf != NULL) ? lf : end) - bytes;
+        if (c->ssize + n > LimitRequestHead || !extend(&c->script, &c->ssize, &c->scapacity, bytes, n))
+        {
+            return false;
+        }
+        if (lf == NULL)
+        {
+            return true;
+        }
+        bytes = lf + 1;
+
+        // trim CR, if any
+        BYTE* line = c->script + c->line;
+        size_t l = c->ssize - c->line;
+        if (l > 0 && line[l - 1] == '\r')
+        {
+            l--;
+        }
+
+        // blank line ends headers
+        if (l == 0)
+        {
+            c->ssize = c->line;
+            ended = true;
+            continue;
+        }
+
+        // ensure line is a header
+        if (memchr(line, ':', l) == NULL)
+        {
+            return false;
+        }
+
+        // Status determines response's code, as does Location (absent Status), and
+        // response's framing is server's, so drop those, keeping others with a CRLF
+        if (l > 7 && strncasecmp(line, "Status:", 7) == 0)
+        {
+            c->status = atoi(line + 7);
+            c->ssize = c->line;
+        }
+        else if ((l > 11 && strncasecmp(line, "Connection:", 11) == 0) ||
+            (l > 15 && strncasecmp(line, "Content-Length:", 15) == 0) ||
+            (l > 18 && strncasecmp(line, "Transfer-Encoding:", 18) == 0))
+        {
+            c->ssize = c->line;
+        }
+        else
+        {
+            if (l > 9 && strncasecmp(line, "Location:", 9) == 0 && c->status == 0)
+            {
+                c->status = 302;
+            }
+            c->ssize = c->line + l;
+            if (!extend(&c->script, &c->ssize, &c->scapacity, "\r\n", 2))
+            {
+                return false;
+            }
+        }
+        c->line = c->ssize;
+    }
+    if (!ended)
+    {
+        return true;
+    }
+
+    // default to 200, mapping codes without a reason phrase to their class's
+    if (c->status == 0)
+    {
+        c->status = 200;
+    }
+    if (c->status < 200 || c->status >= 600)
+    {
+        return false;
+    }
+    if (statuses[c->status].s == NULL)
+    {
+        c->status = (c->status < 300) ? 200 : (c->status < 400) ? 302 : (c->status < 500) ? 400 : 500;
+    }
+
+    // respond with headers, then whatever of body followed them
+    if (c->status == 204 || c->status == 304)
+    {
+        c->chunked = false;
+    }
+    struct iovec headers[] = {{c->script, c->ssize}, {"Transfer-Encoding: chunked\r\n", 28}};
+    respond(c, c->status, headers, (c->chunked) ? 2 : 1, NULL, SIZE_MAX);
+    c->started = true;
+    c->ssize = 0;
+    return forward(c, bytes, end - bytes);
+}
+
+/**
+ * Checks whether client's copy of a file (with entity-tag tag, modified at
+ * modified) is current, per If-None-Match, if any, else If-Modified-Since
+ * (if request is GET or HEAD, and date thereof isn't later than now).
+ * Returns true iff so.
+ */
+bool fresh(client* c, const char* tag, time_t modified)
+{
+    const view* v = header(&c->head, "If-None-Match");
+    if (v != NULL)
+    {
+        return matches(*v, tag);
+    }
+
+    // ignore If-Modified-Since but for GET and HEAD, per RFC 7232, section 3.3
+    view method = c->head.method;
+    if (!(method.length == 3 && memcmp(method.s, "GET", 3) == 0) && !(method.length == 4 && memcmp(method.s, "HEAD", 4) == 0))
+    {
+        return false;
+    }
+
+    // ignore a date later than now too (as from a client whose clock is ahead),
+    // lest a file modified before then seem unmodified
+    v = header(&c->head, "If-Modified-Since");
+    time_t t;
+    if (v == NULL || !timestamp(*v, &t))
+    {
+        return false;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME_COARSE, &ts);
+    return t <= ts.tv_sec && modified <= t;
+}
+
+/**
+ * Handles signals.
+ */
+void handler(int signal)
+{
+    // if user hits control-c
+    if (signal == SIGINT)
+    {
+        signaled = true;
+    }
+
+    // if user asks for more or less to be logged
+    else if (signal == SIGUSR1 && verbosity < LOG_DEBUG)
+    {
+        verbosity++;
+    }
+    else if (signal == SIGUSR2 && verbosity > LOG_ERROR)
+    {
+        verbosity--;
+    }
+}
+
+/**
+ * Stops watching client's connection to FastCGI server, keeping it for
+ * reuse if so requested (and worker has room for it), else closing it.
+ */
+void hangup(client* c, bool keep)
+{
+    epoll_ctl(efd, EPOLL_CTL_DEL, c->cgi, NULL);
+    if (keep && nidle < UPSTREAMS)
+    {
+        idle[nidle++] = c->cgi;
+    }
+    else
+    {
+        close(c->cgi);
+    }
+    c->cgi = -1;
+    c->deadline = 0;
+}
+
+/**
+ * Returns second (of monotonic clock) that's seconds from now.
+ */
+time_t hence(int seconds)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    return ts.tv_sec + seconds;
+}
+
+/**
+ * Checks, in order, whether index.php or index.html exists inside of dir,
+ * whose path (which must have room for either's name) is path, opening it
+ * relative to dir. If so, appends its name to path, stores it in *name,
+ * and returns its descriptor, else returns -1.
+ */
+int indexes(int dir, char* path, const char** name)
+{
+    size_t length = strlen(path);
+    const char* names[] = {"index.php", "index.html"};
+    for (int i = 0; i < 2; i++)
+    {
+        int file = resolve(dir, names[i]);
+        if (file != -1)
+        {
+            strcpy(path + length, names[i]);
+            *name = names[i];
+            return file;
+        }
+    }
+
+    // neither exists, so caller will list directory instead
+    return -1;
+}
+
+/**
+ * Reads file (described by sb), whose local path is path (or, if a
+ * precompressed sibling encoded per content coding coding, that of the file
+ * it encodes) and MIME type is type, into a new entry in cache, along with
+ * its validators, evicting least recently used entries as needed to stay
+ * within budget. Returns entry, else NULL if file isn't cacheable.
+ */
+entry* insert(const char* path, const char* type, int file, const struct stat* sb, int coding)
+{
+    size_t size = sb->st_size;
+
+    // ensure file is small enough to cache, leaving room for others
+    if (share == 0 || size > share / 8)
+    {
+        return NULL;
+    }
+
+    // ensure path is canonical, lest inotify report changes to file by another name
+    if (!canonical(path))
+    {
+        return NULL;
+    }
+
+    // key variants by coding too
+    char key[PATH_MAX + 8];
+    if (coding != -1 && !variant(key, sizeof(key), path, coding))
+    {
+        return NULL;
+    }
+
+    // render headers, including validators
+    char tag[TAG];
+    etag(tag, sb, coding);
+    char headers[BYTES];
+    int n = describe(headers, sizeof(headers), type, coding, tag, sb->st_mtime);
+    n += snprintf(headers + n, sizeof(headers) - n, "Content-Length: %zu\r\n\r\n", size);
+    if (n >= sizeof(headers))
+    {
+        return NULL;
+    }
+    BYTE* response = malloc(n + size);
+    if (response == NULL)
+    {
+        return NULL;
+    }
+    memcpy(response, headers, n);
+
+    // read file's content
+    for (size_t read = 0; read < size; )
+    {
+        ssize_t bytes = pread(file, response + n + read, size - read, read);
+        if (bytes <= 0)
+        {
+            free(response);
+            return NULL;
+        }
+        read += bytes;
+    }
+    entry* e = admit((coding != -1) ? key : path, type, response, n + size);
+    if (e != NULL)
+    {
+        e->coding = coding;
+        e->offset = n;
+        strcpy(e->tag, tag);
+        e->modified = sb->st_mtime;
+    }
+    return e;
+}
+
+/**
+ * Interprets PHP script at path, with query, by way of FastCGI server,
+ * whose output relay then streams to client as it arrives.
+ */
+void interpret(client* c, const char* path, view query)
+{
+    // describe request in params, passing along its fields (save Proxy, per httpoxy)
+    const head* h = &c->head;
+    c->ssize = 0;
+    bool ok = pair(c, "GATEWAY_INTERFACE", 17, "CGI/1.1", 7) &&
+        pair(c, "SERVER_PROTOCOL", 15, h->version.s, h->version.length) &&
+        pair(c, "REQUEST_METHOD", 14, h->method.s, h->method.length) &&
+        pair(c, "REQUEST_URI", 11, h->target.s, h->target.length) &&
+        pair(c, "SCRIPT_NAME", 11, path + rootlength, strlen(path + rootlength)) &&
+        pair(c, "SCRIPT_FILENAME", 15, path, strlen(path)) &&
+        pair(c, "DOCUMENT_ROOT", 13, root, strlen(root)) &&
+        pair(c, "QUERY_STRING", 12, query.s, query.length) &&
+        pair(c, "REDIRECT_STATUS", 15, "200", 3);
+    for (int i = 0; i < h->nfields && ok; i++)
+    {
+        view name = h->fields[i].name;
+        if (name.length == 5 && strncasecmp(name.s, "Proxy", 5) == 0)
+        {
+            continue;
+        }
+        char variable[5 + LimitRequestFieldSize];
+        memcpy(variable, "HTTP_", 5);
+        for (size_t j = 0; j < name.length; j++)
+        {
+            variable[5 + j] = (name.s[j] == '-') ? '_' : toupper((unsigned char) name.s[j]);
+        }
+        ok = pair(c, variable, 5 + name.length, h->fields[i].value.s, h->fields[i].value.length);
+    }
+
+    // frame request as records: begin (as a responder, keeping connection open), params, and (empty) stdin
+    static const BYTE begin[] = {0, 1, 1, 0, 0, 0, 0, 0};
+    c->rsize = 0;
+    ok = ok && record(c, FCGI_BEGIN_REQUEST, begin, sizeof(begin)) &&
+        record(c, FCGI_PARAMS, c->script, c->ssize) && record(c, FCGI_PARAMS, NULL, 0) &&
+        record(c, FCGI_STDIN, NULL, 0);
+    if (!ok)
+    {
+        error(c, 500);
+        return;
+    }
+
+    // relay script's output in chunks, so that connection can persist, unless
+    // client predates chunked transfer coding, in which case closing connection
+    // will delimit it
+    c->chunked = (h->version.length == 8 && memcmp(h->version.s, "HTTP/1.1", 8) == 0);
+    if (!c->chunked)
+    {
+        c->closing = true;
+    }
+
+    // send request over an idle connection to FastCGI server, if any, else a new one
+    if (!upstream(c, true))
+    {
+        error(c, (errno == EAGAIN) ? 503 : 502);
+    }
+}
+
+/**
+ * Appends note n to this worker's journal, without blocking. Returns false
+ * if worker has no journal or it's full (in which case n is dropped), else true.
+ */
+bool jot(const note* n)
+{
+    journal* j = (self != NULL) ? self->journal : NULL;
+    if (j == NULL)
+    {
+        return false;
+    }
+    size_t tail = j->tail;
+    if (tail - __atomic_load_n(&j->head, __ATOMIC_ACQUIRE) == JOURNAL)
+    {
+        __atomic_fetch_add(&j->dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+    j->notes[tail % JOURNAL] = *n;
+    __atomic_store_n(&j->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+/**
+ * Responds to client with directory listing of path (open as file, which
+ * it closes), rendered in one pass into one buffer and cached (until
+ * directory changes), if possible.
+ */
+void list(client* c, int file, const char* path)
+{
+    DIR* dir = fdopendir(file);
+    if (dir == NULL)
+    {
+        close(file);
+        error(c, 500);
+        return;
+    }
+
+    // copy entries' names (omitting .) into client's arena, along with an array
+    // of pointers thereto (doubled as needed, abandoning smaller copies to arena)
+    char** names = NULL;
+    size_t n = 0, capacity = 0;
+    bool ok = true;
+    struct dirent* d;
+    while (ok && (d = readdir(dir)) != NULL)
+    {
+        if (strcmp(d->d_name, ".") == 0)
+        {
+            continue;
+        }
+        if (n == capacity)
+        {
+            char** bigger = allocate(c, (capacity = (capacity == 0) ? 64 : capacity * 2) * sizeof(char*));
+            if (bigger == NULL)
+            {
+                ok = false;
+                break;
+            }
+            if (n > 0)
+            {
+                memcpy(bigger, names, n * sizeof(char*));
+            }
+            names = bigger;
+        }
+        size_t length = strlen(d->d_name);
+        names[n] = allocate(c, length + 1);
+        if (names[n] == NULL)
+        {
+            ok = false;
+            break;
+        }
+        memcpy(names[n++], d->d_name, length + 1);
+    }
+    closedir(dir);
+
+    // sort names as alphasort would (in C locale), moving only pointers thereto
+    if (ok)
+    {
+        qsort(names, n, sizeof(char*), compare);
+    }
+
+    // escape path relative to root into client's arena
+    const char* s = path + rootlength;
+    size_t length = strlen(s);
+    char* relative = allocate(c, escaped(s, length) + 1);
+    if (relative != NULL)
+    {
+        relative[escape(relative, s, length)] = '\0';
+    }
+
+    // render listing
+    BYTE* html = NULL;
+    size_t size = 0;
+    capacity = 0;
+    if (ok && relative != NULL)
+    {
+        const char* parts[] = {"<html><head><title>", relative, "</title></head><body><h1>", relative, "</h1><ul>"};
+        for (int i = 0; i < sizeof(parts) / sizeof(parts[0]) && ok; i++)
+        {
+            ok = extend(&html, &size, &capacity, parts[i], strlen(parts[i]));
+        }
+    }
+    for (size_t i = 0; i < n && ok; i++)
+    {
+        // reserve room for list item, escaping name straight into it
+        const char* name = names[i];
+        size_t length = strlen(name);
+        size_t n = escaped(name, length);
+        if (!reserve(&html, &capacity, size + 13 + n + 2 + n + 9))
+        {
+            ok = false;
+            break;
+        }
+        memcpy(html + size, "<li><a href=\"", 13);
+        size += 13;
+        size += escape(html + size, name, length);
+        memcpy(html + size, "\">", 2);
+        memcpy(html + size + 2, html + size - n, n);
+        size += 2 + n;
+        memcpy(html + size, "</a></li>", 9);
+        size += 9;
+    }
+    ok = ok && relative != NULL && extend(&html, &size, &capacity, "</ul></body></html>", 19);
+
+    // prepend headers, moving listing once, varying per Accept-Encoding since listings are compressible
+    char headers[BYTES];
+    int h = snprintf(headers, sizeof(headers), "Content-Type: text/html\r\nVary: Accept-Encoding\r\nContent-Length: %zu\r\n\r\n", size);
+    if (!ok || !extend(&html, &size, &capacity, headers, h))
+    {
+        free(html);
+        error(c, 500);
+        return;
+    }
+    memmove(html + h, html, size - h);
+    memcpy(html, headers, h);
+
+    // cache listing, if possible, else respond with it just this once, sending it
+    // straight from its buffer (however large) rather than copying it into client's output
+    entry* e = NULL;
+    if (share != 0 && size <= share / 8 && canonical(path))
+    {
+        e = admit(path, "text/html", html, size);
+        if (e == NULL)
+        {
+            error(c, 500);
+            return;
+        }
+        e->offset = h;
+
+        // respond from cache, compressing listing if client accepts as much
+        cached(c, path);
+        return;
+    }
+    e = calloc(1, sizeof(entry));
+    if (e == NULL)
+    {
+        free(html);
+        error(c, 500);
+        return;
+    }
+    e->type = "text/html";
+    e->coding = -1;
+    e->response = html;
+    e->length = size;
+    e->offset = h;
+    e->evicted = true;
+    e->refs = 1;
+    deliver(c, e);
+    release(e);
+}
+
+/**
+ * Checks whether list (of entity-tags, comma-separated, or *) includes tag,
+ * comparing weakly (i.e., ignoring W/). Returns true iff so.
+ */
+bool matches(view list, const char* tag)
+{
+    size_t length = strlen(tag);
+    const char* p = list.s;
+    const char* end = list.s + list.length;
+    while (p < end)
+    {
+        if (*p == ' ' || *p == '\t' || *p == ',')
+        {
+            p++;
+            continue;
+        }
+        if (*p == '*')
+        {
+            return true;
+        }
+        if (end - p >= 2 && p[0] == 'W' && p[1] == '/')
+        {
+            p += 2;
+        }
+        const char* q = p;
+        while (q < end && *q != ',')
+        {
+            q++;
+        }
+        const char* r = q;
+        while (r > p && (r[-1] == ' ' || r[-1] == '\t'))
+        {
+            r--;
+        }
+        if (r - p == length && memcmp(p, tag, length) == 0)
+        {
+            return true;
+        }
+        p = q;
+    }
+    return false;
+}
+
+/**
+ * Counts, in this worker's histogram of stage's latencies, time elapsed since
+ * since (a tick), unless 0 (i.e., stages aren't timed). Returns current tick,
+ * whence a stage that follows can be timed.
+ */
+uint64_t observe(int stage, uint64_t since)
+{
+    if (since == 0)
+    {
+        return 0;
+    }
+    uint64_t now = tick();
+    uint64_t elapsed = now - since;
+    int bin = (elapsed <= (1ULL << SHIFT)) ? 0 : 64 - __builtin_clzll(elapsed - 1) - SHIFT;
+    count(&self->ledger->latencies[stage][(bin < BINS) ? bin : BINS - 1], 1);
+    count(&self->ledger->nanoseconds[stage], elapsed);
+    return now;
+}
+
+/**
+ * Appends a name-value pair, with lengths thereof, to client's params.
+ * Returns true iff successful.
+ */
+bool pair(client* c, const char* name, size_t nlength, const char* value, size_t vlength)
+{
+    // lengths take one byte if less than 128, else four (with high bit set)
+    unsigned char lengths[8];
+    int n = 0;
+    size_t ls[] = {nlength, vlength};
+    for (int i = 0; i < 2; i++)
+    {
+        if (ls[i] < 128)
+        {
+            lengths[n++] = ls[i];
+        }
+        else
+        {
+            lengths[n++] = (ls[i] >> 24) | 0x80;
+            lengths[n++] = ls[i] >> 16;
+            lengths[n++] = ls[i] >> 8;
+            lengths[n++] = ls[i];
+        }
+    }
+    return extend(&c->script, &c->ssize, &c->scapacity, lengths, n) &&
+        extend(&c->script, &c->ssize, &c->scapacity, name, nlength) &&
+        extend(&c->script, &c->ssize, &c->scapacity, value, vlength);
+}
+
+/**
+ * Logs client's pending note, if any, noting how long its request took and
+ * when (per Date header of its response).
+ */
+void post(client* c)
+{
+    if (c->note.status == 0)
+    {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    c->note.duration = (now.tv_sec - c->began.tv_sec) * 1000000 + (now.tv_nsec - c->began.tv_nsec) / 1000;
+    c->note.time = dated;
+    jot(&c->note);
+    c->note.status = 0;
+}
+
+/**
+ * Sets up worker's io_uring instance, mapping its rings into memory and
+ * registering an eventfd (for epoll) to be signaled upon completions.
+ * Returns true iff successful and kernel supports reads therewith.
+ */
+bool prepare(void)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    int fd = syscall(__NR_io_uring_setup, RING, &p);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    // ensure kernel supports reads (which predate probes of support by one release)
+    size_t size = sizeof(struct io_uring_probe) + IORING_OP_LAST * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe* probe = calloc(1, size);
+    bool ok = probe != NULL && syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, IORING_OP_LAST) == 0 &&
+        probe->last_op >= IORING_OP_READ && (probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED);
+    free(probe);
+
+    // map rings (in one mapping, if kernel shares one) and submissions
+    size_t sqsize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    size_t cqsize = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    bool single = (p.features & IORING_FEAT_SINGLE_MMAP);
+    if (single && cqsize > sqsize)
+    {
+        sqsize = cqsize;
+    }
+    BYTE* sq = ok ? mmap(NULL, sqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING) : MAP_FAILED;
+    BYTE* cq = (sq == MAP_FAILED || single) ? sq :
+        mmap(NULL, cqsize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    void* sqes = (cq == MAP_FAILED) ? MAP_FAILED :
+        mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+
+    // signal eventfd upon completions
+    int event = (sqes == MAP_FAILED) ? -1 : eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (event == -1 || syscall(__NR_io_uring_register, fd, IORING_REGISTER_EVENTFD, &event, 1) == -1)
+    {
+        // closing instance's descriptor frees rings once unmapped, which exiting will do
+        if (event != -1)
+        {
+            close(event);
+        }
+        close(fd);
+        return false;
+    }
+    io.fd = fd;
+    io.event = event;
+    io.sqhead = (unsigned*) (sq + p.sq_off.head);
+    io.sqtail = (unsigned*) (sq + p.sq_off.tail);
+    io.sqmask = (unsigned*) (sq + p.sq_off.ring_mask);
+    io.sqarray = (unsigned*) (sq + p.sq_off.array);
+    io.sqes = sqes;
+    io.cqhead = (unsigned*) (cq + p.cq_off.head);
+    io.cqtail = (unsigned*) (cq + p.cq_off.tail);
+    io.cqmask = (unsigned*) (cq + p.cq_off.ring_mask);
+    io.cqes = (struct io_uring_cqe*) (cq + p.cq_off.cqes);
+    return true;
+}
+
+/**
+ * Renders a response (less Status-Line and Date) for every error (4xx or 5xx)
+ * with a reason phrase, using root/CODE.html as its content if present,
+ * else a template.
+ */
+void prerender(void)
+{
+    // template for response's content
+    char* template = "<html><head><title>%i %s</title></head><body><h1>%i %s</h1></body></html>";
+
+    for (int code = 400; code < 600; code++)
+    {
+        // determine code's reason-phrase
+        const char* phrase = reason(code);
+        if (phrase == NULL)
+        {
+            continue;
+        }
+
+        // load root/CODE.html, if present, else render template
+        char* body = NULL;
+        size_t length = 0;
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/%i.html", root, code);
+        FILE* file = fopen(path, "r");
+        if (file != NULL)
+        {
+            struct stat sb;
+            if (fstat(fileno(file), &sb) == 0 && S_ISREG(sb.st_mode) && sb.st_size > 0)
+            {
+                length = sb.st_size;
+                body = malloc(length);
+                if (body != NULL && fread(body, 1, length, file) != length)
+                {
+                    free(body);
+                    body = NULL;
+                }
+            }
+            fclose(file);
+        }
+        if (body == NULL)
+        {
+            length = snprintf(NULL, 0, template, code, phrase, code, phrase);
+            body = malloc(length + 1);
+            if (body == NULL)
+            {
+                stop();
+            }
+            sprintf(body, template, code, phrase, code, phrase);
+        }
+
+        // prepend headers, including, for 405, methods that are allowed, varying (as
+        // would a 200 at same path) per Accept-Encoding, lest caches reuse error for encoded variants
+        char headers[BYTES];
+        int n = snprintf(headers, sizeof(headers), "%sContent-Type: text/html\r\nVary: Accept-Encoding\r\nContent-Length: %zu\r\n\r\n",
+            (code == 405) ? "Allow: GET, HEAD\r\n" : "", length);
+        char* response = malloc(n + length);
+        if (response == NULL)
+        {
+            stop();
+        }
+        memcpy(response, headers, n);
+        memcpy(response + n, body, length);
+        free(body);
+        errors[code].s = response;
+        errors[code].length = n + length;
+    }
+}
+
+/**
+ * Advances client's connection as far as it can without blocking, writing
+ * queued output, then reading and serving requests, in order, one at a time.
+ * Returns false iff connection should be closed.
+ */
+bool process(client* c)
+{
+    while (true)
+    {
+        // relay as much of script's output, if any, as has arrived
+        int relayed = 1;
+        if (c->cgi != -1 && (relayed = relay(c)) == -1)
+        {
+            return false;
+        }
+
+        // log access once last response has been generated (by script, if any)
+        if (c->cgi == -1)
+        {
+            post(c);
+        }
+
+        // write as much of last response as socket will take
+        if (!flush(c))
+        {
+            return false;
+        }
+
+        // wait for epoll to report socket writable before serving any more requests
+        if (c->offset < c->size || c->entry != NULL || c->file != -1)
+        {
+            return true;
+        }
+
+        // wait for FastCGI server to send more of script's output, unless
+        // relay merely paused for client to catch up, which it now has
+        if (c->cgi != -1)
+        {
+            if (relayed == 0)
+            {
+                return true;
+            }
+            continue;
+        }
+
+        // close connection once last response has been written, if so requested
+        if (c->closing)
+        {
+            return false;
+        }
+
+        // check for request
+        // reads whatever is available of the http request into the client's message, 
+        // responding once its head (everything up to CRLF CRLF) has arrived
+        uint64_t began = tick();
+        int status = request(c);
+        if (status == 0)
+        {
+            await(c);
+            return true;
+        }
+        else if (status == -1)
+        {
+            return false;
+        }
+        began = observe(STAGE_READ, began);
+        c->deadline = 0;
+        c->heading = false;
+
+        // respond, deciding whether to keep connection alive, then free
+        // request's scratch memory all at once (keeping arena for any
+        // pipelined request)
+        serve(c);
+        observe(STAGE_SERVE, began);
+        reset(c, c->length > c->end + 2);
+
+        // discard request's head (including final CRLF), keeping any pipelined requests that follow
+        size_t consumed = c->end + 2;
+        memmove(c->message, c->message + consumed, c->length - consumed);
+        c->length -= consumed;
+        c->scanned = 0;
+        c->nlines = 0;
+        c->end = 0;
+
+        // return buffer to pool if nothing follows, lest idle connections hold buffers
+        if (c->length == 0)
+        {
+            relinquish(c);
+        }
+    }
+}
+
+/**
+ * Evicts from cache file (or listing) at path, if cached, and its variants.
+ */
+void purge(const char* path)
+{
+    entry* e = find(path, hash(path, strlen(path)));
+    if (e != NULL)
+    {
+        evict(e);
+    }
+    char key[PATH_MAX + 8];
+    for (int i = 0; i < CODINGS; i++)
+    {
+        if (variant(key, sizeof(key), path, i) && (e = find(key, hash(key, strlen(key)))) != NULL)
+        {
+            evict(e);
+        }
+    }
+}
+
+/**
+ * Appends to client's output whatever of iov's n buffers wasn't among the
+ * first written bytes thereof already written to socket. Returns number of
+ * written bytes beyond those n buffers.
+ */
+size_t queue(client* c, const struct iovec* iov, int n, size_t written)
+{
+    for (int i = 0; i < n; i++)
+    {
+        if (written >= iov[i].iov_len)
+        {
+            written -= iov[i].iov_len;
+        }
+        else
+        {
+            append(c, (BYTE*) iov[i].iov_base + written, iov[i].iov_len - written);
+            written = 0;
+        }
+    }
+    return written;
+}
+
+/**
+ * Returns status code's reason phrase.
+ *
+ * http://www.w3.org/Protocols/rfc2616/rfc2616-sec6.html#sec6
+ * https://tools.ietf.org/html/rfc2324
+ */
+const char* reason(unsigned short code)
+{
+    switch (code)
+    {
+        case 200: return "OK";
+        case 201: return "Created";
+        case 202: return "Accepted";
+        case 204: return "No Content";
+        case 206: return "Partial Content";
+        case 301: return "Moved Permanently";
+        case 302: return "Found";
+        case 303: return "See Other";
+        case 304: return "Not Modified";
+        case 307: return "Temporary Redirect";
+        case 308: return "Permanent Redirect";
+        case 400: return "Bad Request";
+        case 401: return "Unauthorized";
+        case 403: return "Forbidden";
+        case 404: return "Not Found";
+        case 405: return "Method Not Allowed";
+        case 414: return "Request-URI Too Long";
+        case 416: return "Requested Range Not Satisfiable";
+        case 418: return "I'm a teapot";
+        case 500: return "Internal Server Error";
+        case 501: return "Not Implemented";
+        case 502: return "Bad Gateway";
+        case 503: return "Service Unavailable";
+        case 504: return "Gateway Timeout";
+        case 505: return "HTTP Version Not Supported";
+        default: return NULL;
+    }
+}
+
+/**
+ * Recalls what's known of path (of specified length), if anything not yet
+ * expired, without any system calls. Returns entry, else NULL.
+ */
+meta* recall(const char* path, size_t length)
+{
+    if (metas == NULL)
+    {
+        return NULL;
+    }
+    size_t h = hash(path, length);
+    meta* m = &metas[h & (METAS - 1)];
+    if (m->path == NULL || m->hash != h || m->length != length || memcmp(m->path, path, length) != 0)
+    {
+        count(&self->ledger->lapses, 1);
+        return NULL;
+    }
+
+    // coarse clock is read without a system call
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    if (ts.tv_sec >= m->expires)
+    {
+        forget(path, length);
+        count(&self->ledger->lapses, 1);
+        return NULL;
+    }
+    count(&self->ledger->recalls, 1);
+    return m;
+}
+
+/**
+ * Appends to client's FastCGI request a record of specified type with
+ * content of specified length, split into as many records as needed (or one
+ * empty record, if length is 0). Returns true iff successful.
+ */
+bool record(client* c, unsigned char type, const BYTE* content, size_t length)
+{
+    do
+    {
+        // header: version, type, request ID (1), content's length, padding's length, and a reserved byte
+        size_t n = (length > RECORD) ? RECORD : length;
+        BYTE header[] = {1, type, 0, 1, n >> 8, n & 0xFF, 0, 0};
+        if (!extend(&c->records, &c->rsize, &c->rcapacity, header, sizeof(header)) ||
+            !extend(&c->records, &c->rsize, &c->rcapacity, content, n))
+        {
+            return false;
+        }
+        content += n;
+        length -= n;
+    }
+    while (length > 0);
+    return true;
+}
+
+/**
+ * Redirects client to uri.
+ */
+void redirect(client* c, const char* uri)
+{
+    struct iovec headers[] = {{"Location: ", 10}, {(char*) uri, strlen(uri)}, {"\r\n", 2}};
+    respond(c, 301, headers, 3, NULL, 0);
+}
+
+/**
+ * Writes (without blocking) what remains of client's FastCGI request, then
+ * reads as many of server's records as have arrived, forwarding script's
+ * output to client, until client has WATERMARK bytes queued. Returns 1 if
+ * paused for client or script has finished, 0 if waiting for server, or -1
+ * if connection to client should be closed.
+ */
+int relay(client* c)
+{
+    // write request
+    while (c->roffset < c->rsize)
+    {
+        ssize_t bytes = send(c->cgi, c->records + c->roffset, c->rsize - c->roffset, MSG_NOSIGNAL);
+        if (bytes == -1)
+        {
+            // server's buffer is full, so wait for epoll to report socket writable
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                return 0;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+        c->roffset += bytes;
+    }
+
+    // read records
+    while (c->roffset == c->rsize && c->size < WATERMARK)
+    {
+        ssize_t bytes = read(c->cgi, inbound, sizeof(inbound));
+        if (bytes == -1)
+        {
+            // nothing more to read for now, so wait for epoll to report socket
+            // readable, giving server GATEWAY seconds anew if paused till now
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                if (c->deadline == 0)
+                {
+                    c->deadline = hence(GATEWAY);
+                }
+                return 0;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            break;
+        }
+
+        // server closed connection
+        if (bytes == 0)
+        {
+            break;
+        }
+        c->received += bytes;
+
+        // give server another GATEWAY seconds to send more
+        c->deadline = hence(GATEWAY);
+
+        for (BYTE* p = inbound; p < inbound + bytes; )
+        {
+            // read record's header
+            size_t n;
+            if (c->hlength < sizeof(c->header))
+            {
+                n = sizeof(c->header) - c->hlength;
+                if (n > inbound + bytes - p)
+                {
+                    n = inbound + bytes - p;
+                }
+                memcpy(c->header + c->hlength, p, n);
+                c->hlength += n;
+                p += n;
+                if (c->hlength < sizeof(c->header))
+                {
+                    break;
+                }
+                c->content = (c->header[4] << 8) | c->header[5];
+                c->padding = c->header[6];
+            }
+
+            // forward script's output, log its errors, and ignore anything else
+            n = (c->content < inbound + bytes - p) ? c->content : inbound + bytes - p;
+            if (c->header[1] == FCGI_STDOUT && !forward(c, p, n))
+            {
+                hangup(c, false);
+                if (c->started)
+                {
+                    return -1;
+                }
+                error(c, 502);
+                return 1;
+            }
+            else if (c->header[1] == FCGI_STDERR && verbosity >= LOG_WARNING)
+            {
+                // log script's errors (less trailing newlines), escaped lest they forge lines of log
+                size_t length = n;
+                while (length > 0 && (p[length - 1] == '\n' || p[length - 1] == '\r'))
+                {
+                    length--;
+                }
+                char text[NOTE - 8];
+                transcribe(text, sizeof(text), (view) {(const char*) p, length});
+                say(LOG_WARNING, "script: %s", text);
+            }
+            c->content -= n;
+            p += n;
+
+            // skip padding
+            n = (c->padding < inbound + bytes - p) ? c->padding : inbound + bytes - p;
+            c->padding -= n;
+            p += n;
+
+            // await next record, unless this one ended request
+            if (c->content == 0 && c->padding == 0)
+            {
+                c->hlength = 0;
+                if (c->header[1] == FCGI_END_REQUEST)
+                {
+                    hangup(c, c->started);
+                    if (!c->started)
+                    {
+                        error(c, 502);
+                    }
+                    else if (c->chunked && c->status != 204 && c->status != 304 && !c->bodiless && !chunk(c, NULL, 0))
+                    {
+                        return -1;
+                    }
+                    return 1;
+                }
+            }
+        }
+    }
+
+    // paused for client, during which server isn't awaited
+    if (c->roffset == c->rsize && c->size >= WATERMARK)
+    {
+        c->deadline = 0;
+        return 1;
+    }
+
+    // connection to server failed, so try again with a new one if an idle
+    // one had been closed by server before it could respond
+    bool retry = c->reused && c->received == 0;
+    hangup(c, false);
+    if (retry && upstream(c, false))
+    {
+        return relay(c);
+    }
+    if (c->started)
+    {
+        return -1;
+    }
+    error(c, 502);
+    return 1;
+}
+
+/**
+ * Releases a client's hold on entry, freeing it if evicted and no longer in use.
+ */
+void release(entry* e)
+{
+    e->refs--;
+    if (e->evicted && e->refs == 0)
+    {
+        free(e->path);
+        free(e->response);
+        free(e);
+    }
+}
+
+/**
+ * Returns buffer for client's message, if any, to worker's pool (or heap, if
+ * pool is full or buffer was grown).
+ */
+void relinquish(client* c)
+{
+    if (c->message == NULL)
+    {
+        return;
+    }
+    if (nbuffers < POOL && c->mcapacity == BUFFER)
+    {
+        memcpy(c->message, &buffers, sizeof(BYTE*));
+        buffers = c->message;
+        nbuffers++;
+    }
+    else
+    {
+        free(c->message);
+    }
+    c->message = NULL;
+    c->length = 0;
+    c->scanned = 0;
+    c->nlines = 0;
+}
+
+/**
+ * Remembers facts about path (of specified length) for TTL seconds,
+ * replacing whatever's remembered in its bucket, unless path doesn't exist
+ * and NEGATIVES such paths are already remembered.
+ */
+void remember(const char* path, size_t length, const meta* facts)
+{
+    if (metas == NULL)
+    {
+        return;
+    }
+    size_t h = hash(path, length);
+    meta* m = &metas[h & (METAS - 1)];
+
+    // cap entries of paths that don't exist, lest requests for random paths evict all others
+    if (!facts->exists && nnegatives >= NEGATIVES && (m->path == NULL || m->exists))
+    {
+        return;
+    }
+    char* copy = strndup(path, length);
+    if (copy == NULL)
+    {
+        return;
+    }
+    if (m->path != NULL)
+    {
+        if (!m->exists)
+        {
+            nnegatives--;
+        }
+        free(m->path);
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    *m = *facts;
+    m->path = copy;
+    m->length = length;
+    m->hash = h;
+    m->expires = ts.tv_sec + TTL;
+    if (!m->exists)
+    {
+        nnegatives++;
+    }
+}
+
+/**
+ * Reads (without blocking) whatever is available of an HTTP request's head
+ * into client's message, after any bytes of later (pipelined) requests
+ * already read, scanning bytes for CRLFs just once as they arrive.
+ * Returns 1 once message starts with a complete (and valid) head, whose length
+ * is then stored in client's end, 0 if more bytes are needed, or -1 if
+ * request is invalid or connection has been closed.
+ */
+int request(client* c)
+{
+    // ensure socket is open
+    if (c->fd == -1)
+    {
+        return -1;
+    }
+
+    // read message 
+    while (!scan(c->message, c->length, &c->scanned, c->lines, &c->nlines, LimitRequestFields + 2))
+    {
+        // ensure head is no longer than limits allow
+        if (c->length >= LimitRequestHead || c->nlines == LimitRequestFields + 2)
+        {
+            return -1;
+        }
+
+        // borrow a buffer, if client doesn't have one
+        if (c->message == NULL && !acquire(c))
+        {
+            return -1;
+        }
+
+        // grow buffer, if full, by doubling, up to LimitRequestHead + 1 bytes
+        if (c->length + 1 == c->mcapacity)
+        {
+            size_t n = (c->mcapacity * 2 < LimitRequestHead + 1) ? c->mcapacity * 2 : LimitRequestHead + 1;
+            BYTE* b = realloc(c->message, n);
+            if (b == NULL)
+            {
+                return -1;
+            }
+            c->message = b;
+            c->mcapacity = n;
+        }
+
+        // read from socket straight into message
+        ssize_t bytes = read(c->fd, c->message + c->length, c->mcapacity - 1 - c->length);
+        if (bytes == -1)
+        {
+            // nothing more to read for now, so wait for epoll to report socket readable,
+            // returning buffer to pool if connection is idle
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                if (c->length == 0)
+                {
+                    relinquish(c);
+                }
+                return 0;
+            }
+            else if (errno == EINTR)
+            {
+                continue;
+            }
+            return -1;
+        }
+
+        // client closed connection
+        if (bytes == 0)
+        {
+            return -1;
+        }
+        c->length += bytes;
+    }
+
+    // head ends with the blank line whose CRLF was found last, so trim head
+    // to one CRLF and null-terminate, leaving later requests' bytes in place
+    c->end = c->lines[c->nlines - 1];
+    c->message[c->end] = '\0';
+
+    // ensure request-line is no longer than LimitRequestLine
+    if (c->nlines < 2 || c->lines[0] + 2 > LimitRequestLine)
+    {
+        return -1;
+    }
+
+    // ensure each field is no longer than LimitRequestFieldSize
+    for (int i = 1; i < c->nlines - 1; i++)
+    {
+        if (c->lines[i] - c->lines[i - 1] > LimitRequestFieldSize)
+        {
+            return -1;
+        }
+    }
+
+    // ensure message has no more than LimitRequestFields
+    if (c->nlines - 2 > LimitRequestFields)
+    {
+        return -1;
+    }
+
+    // valid
+    return 1;
+}
+
+/**
+ * Ensures buffer has room for size bytes, doubling its capacity as needed.
+ * Returns true iff successful.
+ */
+bool reserve(BYTE** buffer, size_t* capacity, size_t size)
+{
+    if (size <= *capacity)
+    {
+        return true;
+    }
+    size_t n = (*capacity == 0) ? BYTES : *capacity;
+    while (size > n)
+    {
+        n *= 2;
+    }
+    BYTE* b = realloc(*buffer, n);
+    if (b == NULL)
+    {
+        return false;
+    }
+    *buffer = b;
+    *capacity = n;
+    return true;
+}
+
+/**
+ * Resets client's arena after a request, noting how much of it was used,
+ * freeing any blocks chained after it was outgrown, and keeping it for
+ * client's next request iff keep, else returning it to worker's spares.
+ */
+void reset(client* c, bool keep)
+{
+    // note request's usage
+    arena* a = c->arena;
+    if (c->allocated > self->peak)
+    {
+        self->peak = c->allocated;
+    }
+    if (a != NULL && (a->next != NULL || a->capacity != ARENA))
+    {
+        self->overflows++;
+    }
+    c->allocated = 0;
+
+    // free all but arena itself (the oldest block), unless oversized too
+    while (a != NULL && (a->next != NULL || a->capacity != ARENA))
+    {
+        arena* next = a->next;
+        free(a);
+        a = next;
+    }
+    c->arena = a;
+    if (a == NULL)
+    {
+        return;
+    }
+    a->used = 0;
+
+    // return arena to spares, lest idle connections hold arenas
+    if (!keep)
+    {
+        if (nspares < POOL)
+        {
+            a->next = spares;
+            spares = a;
+            nspares++;
+        }
+        else
+        {
+            free(a);
+        }
+        c->arena = NULL;
+    }
+}
+
+/**
+ * Opens path relative to dir (read-only, without blocking), never resolving
+ * beyond dir (whether by .. or by symlinks). If kernel predates openat2,
+ * walks path a component at a time instead, refusing .. and every symlink
+ * (even one that would stay beneath dir). Returns descriptor, else -1 (with
+ * errno set, e.g., to EXDEV if path would have led beyond dir).
+ */
+int resolve(int dir, const char* path)
+{
+    struct open_how how;
+    memset(&how, 0, sizeof(how));
+    how.flags = O_RDONLY | O_NONBLOCK | O_CLOEXEC;
+    how.resolve = RESOLVE_BENEATH | RESOLVE_NO_MAGICLINKS;
+    int fd = syscall(SYS_openat2, dir, path, &how, sizeof(how));
+    if (fd != -1 || errno != ENOSYS)
+    {
+        return fd;
+    }
+
+    // open each directory along path (without following it, if a symlink)
+    // relative to the last, and then path's last component likewise
+    int d = dir;
+    const char* p = path;
+    while (true)
+    {
+        // find component's end, skipping empty components, and whether it's the last
+        while (*p == '/')
+        {
+            p++;
+        }
+        const char* q = strchrnul(p, '/');
+        size_t n = q - p;
+        while (*q == '/')
+        {
+            q++;
+        }
+        bool last = (*q == '\0');
+
+        // copy component, refusing .. (and treating an empty path as .)
+        char name[NAME_MAX + 1];
+        if (n > NAME_MAX || (n == 2 && p[0] == '.' && p[1] == '.'))
+        {
+            errno = (n > NAME_MAX) ? ENAMETOOLONG : EXDEV;
+            fd = -1;
+        }
+        else
+        {
+            memcpy(name, (n > 0) ? p : ".", (n > 0) ? n : 1);
+            name[(n > 0) ? n : 1] = '\0';
+            fd = openat(d, name, (last ? O_RDONLY | O_NONBLOCK : O_PATH | O_DIRECTORY) | O_NOFOLLOW | O_CLOEXEC);
+        }
+
+        // close directory that led here (but not dir itself), preserving openat's errno
+        if (d != dir)
+        {
+            int errsv = errno;
+            close(d);
+            errno = errsv;
+        }
+        if (fd == -1 || last)
+        {
+            return fd;
+        }
+        d = fd;
+        p = q;
+    }
+}
+
+/**
+ * Responds to a client with status code, n headers (each with its CRLF), and
+ * body of specified length, gathering them, along with Date, Content-Length,
+ * and (if closing) Connection headers, into one call to sendmsg.
+ * If body is NULL, length bytes are instead to follow (e.g., from a file),
+ * unless length is SIZE_MAX, in which case body's length is unknown, and so
+ * it is delimited by chunked transfer coding (whose header caller must
+ * provide) or by closing connection.
+ */
+void respond(client* c, int code, const struct iovec* headers, int n, const BYTE* body, size_t length)
+{
+    // determine Status-Line, pre-serialized by start
+    // http://www.w3.org/Protocols/rfc2616/rfc2616-sec6.html#sec6.1
+    if (code < 0 || code >= 600 || statuses[code].s == NULL)
+    {
+        return;
+    }
+    uint64_t began = tick();
+    struct iovec iov[n + 6];
+    int i = 0;
+    iov[i].iov_base = (char*) statuses[code].s;
+    iov[i++].iov_len = statuses[code].length;
+
+    // respond with Date and other headers
+    view d = date();
+    iov[i].iov_base = (char*) d.s;
+    iov[i++].iov_len = d.length;
+    for (int j = 0; j < n; j++)
+    {
+        iov[i++] = headers[j];
+    }
+
+    // respond with body's length, if known (and if response can have a body), so that
+    // connection can persist, converting it to decimal right to left
+    char line[48];
+    if (length != SIZE_MAX && code != 304)
+    {
+        char* p = line + sizeof(line);
+        *--p = '\n';
+        *--p = '\r';
+        size_t digits = length;
+        do
+        {
+            *--p = '0' + digits % 10;
+            digits /= 10;
+        }
+        while (digits > 0);
+        p -= 16;
+        memcpy(p, "Content-Length: ", 16);
+        iov[i].iov_base = p;
+        iov[i++].iov_len = line + sizeof(line) - p;
+    }
+
+    // announce connection's closing, if it will be
+    if (c->closing)
+    {
+        iov[i].iov_base = "Connection: close\r\n";
+        iov[i++].iov_len = 19;
+    }
+
+    // respond with CRLF and body, unless omitted
+    iov[i].iov_base = "\r\n";
+    iov[i++].iov_len = 2;
+    if (body != NULL && !c->bodiless)
+    {
+        iov[i].iov_base = (BYTE*) body;
+        iov[i++].iov_len = length;
+    }
+
+    // write as much as socket will take, queueing the rest
+    queue(c, iov, i, emit(c, iov, i, body == NULL && length != 0 && !c->bodiless));
+    observe(STAGE_RESPOND, began);
+
+    // note access, including body that follows, if its length is known (else
+    // script's output adds to it as it's forwarded)
+    size_t bytes = (body == NULL && length != SIZE_MAX && !c->bodiless) ? length : 0;
+    for (int j = 0; j < i; j++)
+    {
+        bytes += iov[j].iov_len;
+    }
+    account(c, code, bytes);
+}
+
+/**
+ * Logs message, formatted per format, if level is logged: via this worker's
+ * journal, if called by a worker, else straight to stdout.
+ */
+void say(int level, const char* format, ...)
+{
+    if (level > verbosity)
+    {
+        return;
+    }
+    note n = {.time = time(NULL), .status = 0, .level = level};
+    va_list ap;
+    va_start(ap, format);
+    vsnprintf(n.text, sizeof(n.text), format, ap);
+    va_end(ap);
+    if (self == NULL)
+    {
+        char line[NOTE + 16];
+        int length = snprintf(line, sizeof(line), "%s: %s\n", levels[level], n.text);
+        ssize_t written = write(STDOUT_FILENO, line, (length < sizeof(line)) ? length : sizeof(line) - 1);
+        (void) written;
+        return;
+    }
+    jot(&n);
+}
+
+/**
+ * Logs workers' journals, in batches, every FLUSH milliseconds, until
+ * told to stop, whereupon it logs what remains.
+ */
+void* scribe(void* arg)
+{
+    char* batch = malloc(BATCH);
+    if (batch == NULL)
+    {
+        return NULL;
+    }
+    while (true)
+    {
+        bool last = !__atomic_load_n(&writing, __ATOMIC_ACQUIRE);
+        for (int i = 0; i < nworkers; i++)
+        {
+            if (workers[i].journal != NULL)
+            {
+                drain(workers[i].journal, batch);
+            }
+        }
+        if (last)
+        {
+            break;
+        }
+        struct timespec pause = {0, FLUSH * 1000 * 1000};
+        nanosleep(&pause, NULL);
+    }
+    free(batch);
+    return NULL;
+}
+
+/**
+ * Responds to the request whose head is in client's message.
+ */
+void serve(client* c)
+{
+    // parse request's head into views of message // the purpose is to take the very first line and extract the absolute path and query. 
+    // request target is a string that can be broken up into two parts absolute-path like hello.html followed by 
+    // an optional question mark
+    // http://www.w3.org/Protocols/rfc2616/rfc2616-sec5.html
+    c->head.method.length = 0;
+    c->head.path.length = 0;
+    c->bodiless = false;
+    uint64_t began = tick();
+    unsigned short code = parse(c->message, c->lines, c->nlines, &c->head);
+    observe(STAGE_PARSE, began);
+
+    // note when serving began (i.e., when epoll reported request ready), and
+    // request's method and path (as much thereof as parsed), for access's log
+    if (verbosity >= LOG_INFO)
+    {
+        c->began = woke;
+        size_t n = transcribe(c->note.text, NOTE - 1, c->head.method);
+        c->note.text[n++] = ' ';
+        transcribe(c->note.text + n, NOTE - n, c->head.path);
+    }
+    if (code != 0)
+    {
+        // close connection after responding, since request may be malformed
+        c->closing = true;
+        error(c, code);
+        return;
+    }
+    view abs_path = c->head.path;
+    view query = c->head.query;
+
+    // trace request's method and path, as noted for access's log
+    TRACE("request: %s", c->note.text);
+
+    // decide whether to keep connection alive
+    c->closing = !persistent(&c->head);
+
+    // only GET and HEAD are supported, responses to the latter lacking bodies
+    view method = c->head.method;
+    if (method.length == 4 && memcmp(method.s, "HEAD", 4) == 0)
+    {
+        c->bodiless = true;
+    }
+    else if (method.length != 3 || memcmp(method.s, "GET", 3) != 0)
+    {
+        error(c, 405);
+        return;
+    }
+
+    // respond with metrics, if requested
+    if (metrics != NULL && abs_path.length == metricslength && memcmp(abs_path.s, metrics, metricslength) == 0)
+    {
+        expose(c);
+        return;
+    }
+
+    // URL-decode and normalize absolute-path straight into client's path, just after root
+    char* end = urldecode(c->path + rootlength, abs_path.s, abs_path.length);
+    if (end == NULL)
+    {
+        error(c, 400);
+        return;
+    }
+
+    // respond with cached copy of file, if any, before touching filesystem
+    if (cached(c, c->path))
+    {
+        count(&self->ledger->hits, 1);
+        return;
+    }
+
+    // consult cache of metadata before filesystem, responding to paths known not
+    // to exist and redirecting to directories known to be such, and using index
+    // of a directory known to have one
+    meta* m = recall(c->path, end - c->path);
+    if (m != NULL && !m->exists)
+    {
+        error(c, 404);
+        return;
+    }
+    if (m != NULL && m->directory && end[-1] != '/')
+    {
+        slash(c, abs_path);
+        return;
+    }
+    if (m != NULL && m->directory && m->index != NULL)
+    {
+        end = stpcpy(end, m->index);
+        if (cached(c, c->path))
+        {
+            count(&self->ledger->hits, 1);
+            return;
+        }
+        m = recall(c->path, end - c->path);
+    }
+
+    // open path beneath root (lest symlinks lead elsewhere), learning all else about it from that one descriptor
+    began = tick();
+    int file = resolve(rfd, (c->path[rootlength + 1] != '\0') ? c->path + rootlength + 1 : ".");
+    observe(STAGE_RESOLVE, began);
+    if (file == -1)
+    {
+        int e = errno;
+        if (e == ENOENT || e == ENOTDIR)
+        {
+            meta facts = {.exists = false};
+            remember(c->path, end - c->path, &facts);
+        }
+        error(c, (e == ENOENT || e == ENOTDIR || e == ENAMETOOLONG) ? 404 : (e == EACCES || e == EXDEV || e == ELOOP) ? 403 : 500);
+        return;
+    }
+    struct stat sb;
+    if (fstat(file, &sb) == -1)
+    {
+        close(file);
+        error(c, 500);
+        return;
+    }
+
+    // if path to directory 
+    // has user requested a file or a directory? force user to be redirected to not 'foo' but 'foo/'
+    if (S_ISDIR(sb.st_mode))
+    {
+        meta facts = {.exists = true, .directory = true, .mtime = sb.st_mtime};
+
+        // redirect from absolute-path to absolute-path/
+        if (end[-1] != '/')
+        {
+            close(file);
+            remember(c->path, end - c->path, &facts);
+            slash(c, abs_path);
+            return;
+        }
+
+        // use path/index.php or path/index.html, if present, instead of directory's path 
+        // if user has visited a directory and that directory contains a file called index.html or .php, 
+        // we don't want to show them the contents of that directory, we want to show them the contents of 
+        // that default file index.html or .php. this function called index checks "is there a file in here 
+        // called index.html or .php?"
+        int index = indexes(file, c->path, &facts.index);
+        remember(c->path, end - c->path, &facts);
+        if (index != -1)
+        {
+            close(file);
+            file = index;
+            end += strlen(end);
+
+            // respond with cached copy of index, if any
+            if (cached(c, c->path))
+            {
+                count(&self->ledger->hits, 1);
+                close(file);
+                return;
+            }
+            if (fstat(file, &sb) == -1)
+            {
+                close(file);
+                error(c, 500);
+                return;
+            }
+        }
+        // list contents of directory
+        else
+        {
+            count(&self->ledger->misses, 1);
+            list(c, file, c->path);
+            return;
+        }
+    }
+
+    // serve only regular files (and not, e.g., devices or FIFOs)
+    if (!S_ISREG(sb.st_mode))
+    {
+        close(file);
+        error(c, 403);
+        return;
+    }
+
+    // look up MIME type for file at path, unless already known
+    // if user requests is not for a directory but for a file, lookup function tell the 
+    // server is this a jpeg? is this a gif? 
+    const char* type = (m != NULL && m->type != NULL) ? m->type : lookup(c->path);
+    if (type == NULL)
+    {
+        close(file);
+        error(c, 501);
+        return;
+    }
+    meta facts = {.exists = true, .size = sb.st_size, .mtime = sb.st_mtime, .type = type};
+    remember(c->path, end - c->path, &facts);
+
+    // interpret PHP script at path 
+    // if the above is true, this will say is it a php file? then call function called interpret (staff wrote
+    // it interprets php file and spits out results
+    if (strcasecmp("text/x-php", type) == 0)
+    {
+        close(file);
+        began = tick();
+        interpret(c, c->path, query);
+        observe(STAGE_INTERPRET, began);
+    }
+    // if it's anything else, transfer the file from the server to the user as if they requested an html page, img, etc
+    // transfer file at path
+    else
+    {
+        count(&self->ledger->misses, 1);
+        began = tick();
+        transfer(c, file, &sb, c->path, type);
+        observe(STAGE_TRANSFER, began);
+    }
+}
+
+/**
+ * Opens file at path's sibling precompressed per content coding coding (e.g.,
+ * path.br), unless known not to exist, storing its metadata in *sb. Returns
+ * its descriptor, if a regular file at least as new as modified, else -1.
+ */
+int sibling(client* c, const char* path, time_t modified, int coding, struct stat* sb)
+{
+    size_t length = strlen(path), n = strlen(codings[coding].suffix);
+    char* s = allocate(c, length + n + 1);
+    if (s == NULL)
+    {
+        return -1;
+    }
+    memcpy(s, path, length);
+    memcpy(s + length, codings[coding].suffix, n + 1);
+
+    // consult cache of metadata before filesystem, since most files have no siblings
+    meta* m = recall(s, length + n);
+    if (m != NULL && !m->exists)
+    {
+        return -1;
+    }
+    int file = resolve(rfd, s + rootlength + 1);
+    if (file == -1)
+    {
+        if (errno == ENOENT || errno == ENOTDIR)
+        {
+            meta facts = {.exists = false};
+            remember(s, length + n, &facts);
+        }
+        return -1;
+    }
+    if (fstat(file, sb) == -1 || !S_ISREG(sb->st_mode) || sb->st_mtime < modified)
+    {
+        close(file);
+        return -1;
+    }
+    return file;
+}
+
+/**
+ * Redirects client from absolute-path (of a directory) to absolute-path/.
+ */
+void slash(client* c, view path)
+{
+    char* uri = allocate(c, path.length + 1 + 1);
+    if (uri == NULL)
+    {
+        error(c, 500);
+        return;
+    }
+    memcpy(uri, path.s, path.length);
+    uri[path.length] = '/';
+    uri[path.length + 1] = '\0';
+    redirect(c, uri);
+}
+
+/**
+ * Starts php-cgi, with specified number of children, listening on a socket
+ * of its own in a process group of its own, and waits (briefly) for it to
+ * accept connections.
+ */
+void spawn(int children)
+{
+    fastcgi = malloc(PATH_MAX);
+    if (fastcgi == NULL)
+    {
+        stop();
+    }
+    snprintf(fastcgi, PATH_MAX, "/tmp/server.%i.sock", getpid());
+    unlink(fastcgi);
+
+    pid_t pid = fork();
+    if (pid == -1)
+    {
+        return;
+    }
+    if (pid == 0)
+    {
+        // restore signals' defaults, lest php-cgi inherit server's
+        sigset_t mask;
+        sigemptyset(&mask);
+        sigprocmask(SIG_SETMASK, &mask, NULL);
+        signal(SIGPIPE, SIG_DFL);
+        setpgid(0, 0);
+
+        char n[16];
+        snprintf(n, sizeof(n), "%i", children);
+        setenv("PHP_FCGI_CHILDREN", n, 1);
+        execlp("php-cgi", "php-cgi", "-b", fastcgi, NULL);
+        _exit(127);
+    }
+    php = pid;
+
+    // wait up to a second for socket
+    for (int i = 0; i < 100; i++)
+    {
+        int fd = dial();
+        if (fd != -1)
+        {
+            close(fd);
+            return;
+        }
+        if (waitpid(pid, NULL, WNOHANG) == pid)
+        {
+            break;
+        }
+        usleep(10000);
+    }
+    say(LOG_ERROR, "Could not start php-cgi");
+}
+
+/**
+ * Compresses length bytes per content coding coding, storing compressed
+ * length in *n. Returns dynamically allocated memory for compressed bytes
+ * that must be deallocated by caller, else NULL.
+ */
+BYTE* squeeze(int coding, const BYTE* bytes, size_t length, size_t* n)
+{
+    if (coding == BROTLI)
+    {
+        // compress as text at a quality cheap enough to do per request
+        *n = BrotliEncoderMaxCompressedSize(length);
+        BYTE* compressed = (*n > 0) ? malloc(*n) : NULL;
+        if (compressed == NULL || !BrotliEncoderCompress(5, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, length,
+            (const uint8_t*) bytes, n, (uint8_t*) compressed))
+        {
+            free(compressed);
+            return NULL;
+        }
+        return compressed;
+    }
+    if (coding == GZIP && length <= UINT_MAX)
+    {
+        // deflate with a gzip wrapper (per 16 added to window's bits)
+        z_stream z;
+        memset(&z, 0, sizeof(z));
+        if (deflateInit2(&z, 6, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+        {
+            return NULL;
+        }
+        size_t bound = deflateBound(&z, length);
+        BYTE* compressed = malloc(bound);
+        z.next_in = (Bytef*) bytes;
+        z.avail_in = length;
+        z.next_out = (Bytef*) compressed;
+        z.avail_out = bound;
+        int status = (compressed != NULL) ? deflate(&z, Z_FINISH) : Z_MEM_ERROR;
+        *n = z.total_out;
+        deflateEnd(&z);
+        if (status != Z_STREAM_END)
+        {
+            free(compressed);
+            return NULL;
+        }
+        return compressed;
+    }
+    return NULL;
+}
+
+/**
+ * Starts server on specified port rooted at path, with n workers, each of
+ * which listens on its own socket.
+ */
+void start(short port, const char* path, int n)
+{
+    // path to server's root
+     root = realpath(path, NULL);
+    // root = "../server.c";
+
+    if (root == NULL)
+    {
+        stop();
+    }
+
+    // ensure root is executable
+    if (access(root, X_OK) == -1)
+    {
+        stop();
+    }
+    rootlength = strlen(root);
+    rfd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (rfd == -1)
+    {
+        stop();
+    }
+
+    // announce root
+    say(LOG_INFO, "Using %s for server's root", root);
+
+    // serialize Status-Line for every status code with a reason phrase
+    for (int code = 100; code < 600; code++)
+    {
+        const char* phrase = reason(code);
+        if (phrase != NULL)
+        {
+            char* line = malloc(9 + 4 + strlen(phrase) + 2 + 1);
+            if (line == NULL)
+            {
+                stop();
+            }
+            statuses[code].s = line;
+            statuses[code].length = sprintf(line, "HTTP/1.1 %i %s\r\n", code, phrase);
+        }
+    }
+
+    // render every error's response
+    prerender();
+
+    // create eventfd by which workers will be told to stop
+    wfd = eventfd(0, EFD_CLOEXEC);
+    if (wfd == -1)
+    {
+        stop();
+    }
+
+    // allocate workers
+    workers = calloc(n, sizeof(worker));
+    if (workers == NULL)
+    {
+        stop();
+    }
+
+    // give each worker its own socket, all bound to same port, so that kernel balances connections across them
+    for (int i = 0; i < n; i++)
+    {
+        // create a socket that never blocks
+        workers[i].sfd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (workers[i].sfd == -1)
+        {
+            stop();
+        }
+        nworkers++;
+
+        // allow reuse of address (to avoid "Address already in use") and of port (by every worker)
+        int optval = 1;
+        setsockopt(workers[i].sfd, SOL_SOCKET, SO_REUSEADDR, &optval, sizeof(optval));
+        setsockopt(workers[i].sfd, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof(optval));
+
+        // assign name to socket
+        struct sockaddr_in serv_addr;
+        memset(&serv_addr, 0, sizeof(serv_addr));
+        serv_addr.sin_family = AF_INET;
+        serv_addr.sin_port = htons(port);
+        serv_addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(workers[i].sfd, (struct sockaddr*) &serv_addr, sizeof(serv_addr)) == -1)
+        {
+            say(LOG_ERROR, "Port %i already in use", port);
+            stop();
+        }
+
+        // listen for connections
+        if (listen(workers[i].sfd, SOMAXCONN) == -1)
+        {
+            stop();
+        }
+    }
+
+    // announce port in use
+    struct sockaddr_in addr;
+    socklen_t addrlen = sizeof(addr);
+    if (getsockname(workers[0].sfd, (struct sockaddr*) &addr, &addrlen) == -1)
+    {
+        stop();
+    }
+    say(LOG_INFO, "Listening on port %i with %i worker%s", ntohs(addr.sin_port), n, (n == 1) ? "" : "s");
+
+    // start php-cgi, unless some FastCGI server's socket was specified
+    if (fastcgi == NULL)
+    {
+        spawn(n * CHILDREN);
+    }
+    else if (strlen(fastcgi) >= sizeof(((struct sockaddr_un*) NULL)->sun_path))
+    {
+        stop();
+    }
+    say(LOG_INFO, "Using FastCGI server at %s", fastcgi);
+
+    // give each worker a journal (without which its notes are dropped), then start scribe
+    for (int i = 0; i < n; i++)
+    {
+        workers[i].journal = aligned_alloc(64, sizeof(journal));
+        if (workers[i].journal != NULL)
+        {
+            workers[i].journal->head = 0;
+            workers[i].journal->tail = 0;
+            workers[i].journal->dropped = 0;
+        }
+    }
+
+    // give each worker a ledger of statistics, on cache lines of its own
+    for (int i = 0; i < n; i++)
+    {
+        workers[i].ledger = aligned_alloc(64, (sizeof(ledger) + 63) & ~(size_t) 63);
+        if (workers[i].ledger == NULL)
+        {
+            stop();
+        }
+        memset(workers[i].ledger, 0, sizeof(ledger));
+    }
+    writing = true;
+    if (pthread_create(&writer, NULL, scribe, NULL) != 0)
+    {
+        writing = false;
+        stop();
+    }
+
+    // start workers
+    for (int i = 0; i < n; i++)
+    {
+        if (pthread_create(&workers[i].thread, NULL, work, &workers[i]) != 0)
+        {
+            stop();
+        }
+    }
+}
+
+/**
+ * Stop server, deallocating any resources.
+ */
+void stop(void)
+{
+    // preserve errno across this function's library calls
+    int errsv = errno;
+
+    // announce stop
+    say(LOG_INFO, "Stopping server");
+
+    // log what remains of workers' journals, unless already logged
+    if (__atomic_exchange_n(&writing, false, __ATOMIC_ACQ_REL))
+    {
+        pthread_join(writer, NULL);
+    }
+
+    // free root, which was allocated by realpath
+    if (root != NULL)
+    {
+        free(root);
+    }
+
+    // close workers' sockets, and free their journals and ledgers
+    for (int i = 0; i < nworkers; i++)
+    {
+        close(workers[i].sfd);
+        free(workers[i].journal);
+        free(workers[i].ledger);
+    }
+    if (workers != NULL)
+    {
+        free(workers);
+    }
+
+    // close eventfd
+    if (wfd != -1)
+    {
+        close(wfd);
+    }
+
+    // stop php-cgi (and its children), if started
+    if (php > 0)
+    {
+        kill(-php, SIGTERM);
+        waitpid(php, NULL, 0);
+        unlink(fastcgi);
+    }
+
+    // stop server
+    exit(errsv);
+}
+
+/**
+ * Sends file (open as specified, with specified status), whose path is path
+ * (or, if a precompressed sibling encoded per content coding coding, that of
+ * the file it encodes) with specified type to client, closing it once sent.
+ */
+void stream(client* c, int file, const struct stat* sb, const char* path, const char* type, int coding)
+{
+    // cache file, if possible, and respond from cache
+    entry* e = insert(path, type, file, sb, coding);
+    if (e != NULL)
+    {
+        close(file);
+        deliver(c, e);
+        return;
+    }
+
+    // respond to conditional or range request, if any
+    char tag[TAG];
+    etag(tag, sb, coding);
+    if (conditional(c, tag, sb->st_mtime, type, sb->st_size, NULL, file, coding))
+    {
+        return;
+    }
+
+    // prepare response
+    char lines[BYTES];
+    struct iovec headers[] = {{lines, describe(lines, sizeof(lines), type, coding, tag, sb->st_mtime)}};
+
+    // respond with headers, leaving file's content (unless omitted) to be sent by flush
+    respond(c, 200, headers, 1, NULL, sb->st_size);
+    if (c->bodiless)
+    {
+        close(file);
+        return;
+    }
+    c->file = file;
+    c->position = 0;
+    c->remaining = sb->st_size;
+}
+
+/**
+ * Submits to worker's io_uring instance a read of client's file's next chunk
+ * (of at most CHUNK bytes) into client's output. Returns true iff successful.
+ */
+bool submit(client* c)
+{
+    size_t length = (c->remaining < CHUNK) ? c->remaining : CHUNK;
+    if (!reserve(&c->output, &c->capacity, length))
+    {
+        return false;
+    }
+
+    // fill in next submission (queue can't be full, since each is submitted at once)
+    unsigned tail = *io.sqtail;
+    unsigned index = tail & *io.sqmask;
+    struct io_uring_sqe* sqe = &io.sqes[index];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = c->file;
+    sqe->off = c->position;
+    sqe->addr = (uintptr_t) c->output;
+    sqe->len = length;
+    sqe->user_data = (uintptr_t) c;
+    io.sqarray[index] = index;
+    __atomic_store_n(io.sqtail, tail + 1, __ATOMIC_RELEASE);
+
+    // once queued, read may complete whether or not this call succeeds, so
+    // output mustn't be reused until it does
+    c->reading = true;
+    int submitted;
+    do
+    {
+        submitted = syscall(__NR_io_uring_enter, io.fd, 1, 0, 0, NULL, 0);
+    }
+    while (submitted == -1 && errno == EINTR);
+    if (submitted == 1)
+    {
+        return true;
+    }
+
+    // unless kernel consumed submission anyway, withdraw it, since no completion will come
+    if (__atomic_load_n(io.sqhead, __ATOMIC_ACQUIRE) == tail)
+    {
+        __atomic_store_n(io.sqtail, tail, __ATOMIC_RELEASE);
+        c->reading = false;
+    }
+    return false;
+}
+
+/**
+ * Closes (at most once per second) connections of this worker's clients that
+ * are past their deadlines, save those awaiting a FastCGI server that has
+ * yet to start responding, to which it instead responds with 504.
+ */
+void sweep(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    if (ts.tv_sec == swept)
+    {
+        return;
+    }
+    swept = ts.tv_sec;
+    client* c = connections;
+    while (c != NULL)
+    {
+        // remember next client, since disconnecting this one removes it from list
+        client* older = c->older;
+        if (c->deadline != 0 && c->deadline <= ts.tv_sec)
+        {
+            if (c->cgi != -1 && !c->started)
+            {
+                TRACE("abandoning script for connection %i, past its deadline", c->fd);
+                hangup(c, false);
+                error(c, 504);
+                if (!process(c))
+                {
+                    disconnect(c);
+                }
+            }
+            else
+            {
+                TRACE("closing connection %i, past its deadline", c->fd);
+                disconnect(c);
+            }
+        }
+        c = older;
+    }
+}
+
+/**
+ * Returns monotonic clock's time, in nanoseconds, if stages are timed (i.e.,
+ * metrics are exposed), else 0.
+ */
+uint64_t tick(void)
+{
+    if (metrics == NULL)
+    {
+        return 0;
+    }
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/**
+ * Parses v as an HTTP-date (in its preferred, IMF-fixdate format) into t.
+ * Returns true iff successful.
+ */
+bool timestamp(view v, time_t* t)
+{
+    char s[64];
+    if (v.length >= sizeof(s))
+    {
+        return false;
+    }
+    memcpy(s, v.s, v.length);
+    s[v.length] = '\0';
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    char* end = strptime(s, "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    if (end == NULL || *end != '\0')
+    {
+        return false;
+    }
+    *t = timegm(&tm);
+    return true;
+}
+
+/**
+ * Copies into t (of size bytes) as much of v as fits (or, if v is empty, a
+ * hyphen), escaping control characters, quotes, and backslashes (as \xHH),
+ * lest they forge lines of log, then null-terminates t. Returns number of
+ * bytes copied, less terminator.
+ */
+size_t transcribe(char* t, size_t size, view v)
+{
+    size_t n = 0;
+    if (v.length == 0 && size > 1)
+    {
+        t[n++] = '-';
+    }
+    for (size_t i = 0; i < v.length; i++)
+    {
+        unsigned char ch = v.s[i];
+        if (ch < 0x20 || ch == 0x7f || ch == '"' || ch == '\\')
+        {
+            if (n + 4 >= size)
+            {
+                break;
+            }
+            n += sprintf(t + n, "\\x%02x", ch);
+        }
+        else
+        {
+            if (n + 1 >= size)
+            {
+                break;
+            }
+            t[n++] = ch;
+        }
+    }
+    t[n] = '\0';
+    return n;
+}
+
+/**
+ * Transfers file (open as specified, with specified status) at path with
+ * specified type to client, closing it once sent, instead sending a
+ * precompressed sibling (or compressing file on the fly) if client accepts
+ * a content coding and type is compressible.
+ */
+void transfer(client* c, int file, const struct stat* sb, const char* path, const char* type)
+{
+    int accepts = compressible(type) ? accepted(c) : 0;
+    if (accepts != 0)
+    {
+        // prefer a precompressed sibling (e.g., path.br), if as new as file
+        for (int i = 0; i < CODINGS; i++)
+        {
+            struct stat ssb;
+            int s;
+            if ((accepts & (1 << i)) && (s = sibling(c, path, sb->st_mtime, i, &ssb)) != -1)
+            {
+                close(file);
+                stream(c, s, &ssb, path, type, i);
+                return;
+            }
+        }
+
+        // else cache file, if possible, and respond from cache, which compresses it
+        entry* e = insert(path, type, file, sb, -1);
+        if (e != NULL)
+        {
+            close(file);
+            cached(c, path);
+            return;
+        }
+    }
+    stream(c, file, sb, path, type, -1);
+}
+
+/**
+ * Attaches to client an idle connection to FastCGI server, if any and if
+ * reuse is requested, else a new one, watching it (edge-triggered) for
+ * reading and writing on client's behalf. Returns true iff successful.
+ */
+bool upstream(client* c, bool reuse)
+{
+    int fd;
+    if (reuse && nidle > 0)
+    {
+        fd = idle[--nidle];
+        c->reused = true;
+    }
+    else
+    {
+        fd = dial();
+        if (fd == -1)
+        {
+            return false;
+        }
+        c->reused = false;
+    }
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+    event.data.ptr = c;
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, fd, &event) == -1)
+    {
+        close(fd);
+        return false;
+    }
+    c->cgi = fd;
+    c->received = 0;
+    c->roffset = 0;
+    c->hlength = 0;
+    c->content = 0;
+    c->padding = 0;
+    c->ssize = 0;
+    c->line = 0;
+    c->status = 0;
+    c->started = false;
+
+    // give server GATEWAY seconds to accept request and start responding
+    c->deadline = hence(GATEWAY);
+    return true;
+}
+
+/**
+ * Formats into s (of size bytes) ETag, Last-Modified, and Accept-Ranges
+ * headers for a file with entity-tag tag (if not empty), modified at
+ * modified, encoded per content coding coding (if not -1), in which case
+ * ranges aren't accepted. Returns number of bytes formatted.
+ */
+int validators(char* s, size_t size, const char* tag, time_t modified, int coding)
+{
+    if (tag[0] == '\0')
+    {
+        return 0;
+    }
+    struct tm tm;
+    gmtime_r(&modified, &tm);
+    char date[32];
+    strftime(date, sizeof(date), "%a, %d %b %Y %H:%M:%S GMT", &tm);
+    int n = snprintf(s, size, "ETag: %s\r\nLast-Modified: %s\r\nAccept-Ranges: %s\r\n",
+        tag, date, (coding == -1) ? "bytes" : "none");
+    return (n < size) ? n : 0;
+}
+
+/**
+ * Formats into key (of size bytes) cache's key for variant of file (or
+ * listing) at path encoded per content coding coding. Returns true iff key fits.
+ */
+bool variant(char* key, size_t size, const char* path, int coding)
+{
+    // prefix path, which (being absolute) can't otherwise start with a coding's token
+    int n = snprintf(key, size, "%s:%s", codings[coding].token, path);
+    return n >= 0 && n < size;
+}
+
+/**
+ * Adds inotify watches to directory at path and, recursively, to every
+ * directory therein. Returns true iff all were added.
+ */
+bool watch(const char* path)
+{
+    uint32_t mask = IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF |
+        IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+    int wd = inotify_add_watch(ifd, path, mask);
+    if (wd == -1)
+    {
+        return false;
+    }
+
+    // remember directory's path by watch descriptor
+    if (wd >= nwatches)
+    {
+        int n = (wd + 1 > nwatches * 2) ? wd + 1 : nwatches * 2;
+        char** w = realloc(watches, n * sizeof(char*));
+        if (w == NULL)
+        {
+            return false;
+        }
+        for (int i = nwatches; i < n; i++)
+        {
+            w[i] = NULL;
+        }
+        watches = w;
+        nwatches = n;
+    }
+    if (watches[wd] == NULL)
+    {
+        watches[wd] = strdup(path);
+        if (watches[wd] == NULL)
+        {
+            return false;
+        }
+    }
+
+    // watch subdirectories
+    DIR* dir = opendir(path);
+    if (dir == NULL)
+    {
+        return false;
+    }
+    bool watched = true;
+    struct dirent* d;
+    while ((d = readdir(dir)) != NULL)
+    {
+        if (d->d_type != DT_DIR || strcmp(d->d_name, ".") == 0 || strcmp(d->d_name, "..") == 0)
+        {
+            continue;
+        }
+        char subdirectory[PATH_MAX];
+        if (snprintf(subdirectory, sizeof(subdirectory), "%s/%s", path, d->d_name) >= sizeof(subdirectory) ||
+            !watch(subdirectory))
+        {
+            watched = false;
+        }
+    }
+    closedir(dir);
+    return watched;
+}
+
+/**
+ * Runs a worker's event loop, accepting and serving connections on its
+ * socket until told to stop.
+ */
+void* work(void* arg)
+{
+    worker* w = arg;
+    self = w;
+    sfd = w->sfd;
+
+    // create an epoll instance
+    efd = epoll_create1(EPOLL_CLOEXEC);
+    if (efd == -1)
+    {
+        stop();
+    }
+
+    // watch for connections (edge-triggered), registering server's socket without a client
+    struct epoll_event event;
+    event.events = EPOLLIN | EPOLLET;
+    event.data.ptr = NULL;
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, sfd, &event) == -1)
+    {
+        stop();
+    }
+
+    // allocate cache of metadata (without which paths' metadata simply won't be cached)
+    metas = calloc(METAS, sizeof(meta));
+
+    // watch root for changes to files, so that they can be cached, unless
+    // some part of it can't be watched
+    share = budget / nworkers;
+    ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (ifd == -1 || !watch(root))
+    {
+        share = 0;
+    }
+    if (ifd != -1)
+    {
+        event.events = EPOLLIN | EPOLLET;
+        event.data.ptr = &ifd;
+        if (epoll_ctl(efd, EPOLL_CTL_ADD, ifd, &event) == -1)
+        {
+            share = 0;
+        }
+    }
+
+    // read files with io_uring, if so requested and supported, else send them with sendfile
+    if (uring)
+    {
+        if (prepare())
+        {
+            event.events = EPOLLIN | EPOLLET;
+            event.data.ptr = &io;
+            if (epoll_ctl(efd, EPOLL_CTL_ADD, io.event, &event) == -1)
+            {
+                stop();
+            }
+        }
+        else if (w == workers)
+        {
+            say(LOG_WARNING, "io_uring unavailable, so using sendfile");
+        }
+    }
+
+    // watch for being told to stop (level-triggered, so that every worker hears)
+    event.events = EPOLLIN;
+    event.data.ptr = &wfd;
+    if (epoll_ctl(efd, EPOLL_CTL_ADD, wfd, &event) == -1)
+    {
+        stop();
+    }
+
+    // events reported by epoll
+    struct epoll_event events[EVENTS];
+
+    // multiplex this worker's connections on its one thread
+    // loops infinitely, waiting for epoll to report that the server's socket or some client's socket is ready
+    while (true)
+    {
+        // wait for sockets to become ready, waking at least once per second to sweep
+        int n = epoll_wait(efd, events, EVENTS, 1000);
+        if (n == -1)
+        {
+            // interrupted by a signal, perhaps control-c
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            stop();
+        }
+
+        // note when requests now ready began to be served, if accesses are logged
+        if (verbosity >= LOG_INFO)
+        {
+            clock_gettime(CLOCK_MONOTONIC, &woke);
+        }
+
+        for (int i = 0; i < n; i++)
+        {
+            // check whether worker has been told to stop
+            if (events[i].data.ptr == &wfd)
+            {
+                close(efd);
+                return NULL;
+            }
+
+            // check whether files have been read
+            if (events[i].data.ptr == &io)
+            {
+                completed();
+                continue;
+            }
+
+            // check whether files have changed
+            if (events[i].data.ptr == &ifd)
+            {
+                changed();
+                continue;
+            }
+
+            // check whether clients have connected
+            // the server's socket is registered without a client
+            if (events[i].data.ptr == NULL)
+            {
+                while (connected());
+                continue;
+            }
+            client* c = events[i].data.ptr;
+
+            // ignore events for a client disconnected while handling earlier ones
+            if (c->disconnected)
+            {
+                continue;
+            }
+
+            // close connection on error or hangup, unless perhaps of client's
+            // connection to FastCGI server, which relay handles
+            if ((events[i].events & (EPOLLERR | EPOLLHUP)) && c->cgi == -1)
+            {
+                disconnect(c);
+                continue;
+            }
+
+            // read, serve, and respond to as many requests as socket allows
+            if (!process(c))
+            {
+                disconnect(c);
+            }
+        }
+
+        // close connections that are past their deadlines
+        sweep();
+
+        // reuse clients disconnected meanwhile, now that no event in hand is for them
+        while (departed != NULL)
+        {
+            client* c = departed;
+            departed = c->next;
+            c->next = clients;
+            clients = c;
+        }
+    }
+}
 